@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AudioConditioner.h"
+
+class AsrVosk;
+struct AsrResult;
+
+// Offline transcription of many WAV files with one shared model.
+struct AsrBatchConfig {
+    std::string input;          // directory (searched recursively), .wav file, or text file listing paths
+    std::string outputPath = "stt_batch.jsonl";
+    int threads = 0;            // 0: one worker per hardware thread
+    ConditionerConfig cond;     // applied to every file when any stage is enabled
+};
+
+// One long recording split for parallel decoding.
+struct AsrLongConfig {
+    std::string input;              // WAV file
+    std::string outputPath;         // optional: merged Vosk-style JSON result
+    int threads = 0;                // 0: one worker per hardware thread
+    double segmentSeconds = 20.0;   // target length; shortened so every worker gets a share
+    double searchSeconds = 4.0;     // cuts are placed in the quietest pause within +/- this
+    double overlapSeconds = 1.0;    // extra audio decoded on each side of a cut
+    ConditionerConfig cond;
+};
+
+// Span of one segment, in samples. Each segment decodes [begin, end) but
+// only keeps words centred in [ownBegin, ownEnd); owned spans tile the
+// recording, so overlapping audio is transcribed once in the final text.
+struct AsrSegment {
+    size_t begin = 0, end = 0;
+    size_t ownBegin = 0, ownEnd = 0;
+};
+
+#ifdef WITH_VOSK
+// Cuts `pcm` at the quietest 200 ms stretch near every segment boundary.
+std::vector<AsrSegment> splitAtSilence(const std::vector<int16_t>& pcm, double sampleRate,
+                                       const AsrLongConfig& cfg, size_t workers);
+
+// Collects the .wav files named by `input`, sorted by path. Returns false
+// (with a message on stderr) when the input does not exist.
+bool collectWavFiles(const std::string& input, std::vector<std::string>& files);
+
+// Transcribes every file on cfg.threads workers, each holding its own
+// recognizer, and writes one JSON object per file to cfg.outputPath in input
+// order. Reports files/s and the real-time factor. Returns a process exit code.
+int runBatchTranscription(AsrVosk& asr, const AsrBatchConfig& cfg);
+
+// Decodes the segments of one recording (already at AsrVosk::kSampleRate)
+// concurrently on `workers` recognizers and stitches the words back in order,
+// with times relative to the start of the recording. Segments no worker could
+// get a recognizer for are left out and counted in `failedSegments`.
+AsrResult transcribeLong(AsrVosk& asr, const std::vector<int16_t>& pcm,
+                         const std::vector<AsrSegment>& segments, size_t workers,
+                         size_t* failedSegments = nullptr);
+
+// --stt-long: load, condition, split, transcribe, report speed-up and RTF.
+int runLongTranscription(AsrVosk& asr, const AsrLongConfig& cfg);
+#endif
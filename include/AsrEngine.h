@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct AsrWord {
+    std::string word;
+    double start = 0.0;   // seconds from the start of the utterance
+    double end = 0.0;
+    double conf = 0.0;    // 0..1
+};
+
+// Outcome of decoding one utterance.
+struct AsrResult {
+    std::string text;
+    std::vector<AsrWord> words;
+    // Vosk-style result JSON: {"text": ..., "result": [words]}. Segments
+    // closed at internal pauses are merged into one object.
+    std::string json = "{}";
+    double decodeMs = 0.0;
+
+    // Mean word confidence, 0 when there are no words.
+    double confidence() const;
+    // Adds one Vosk result/final_result object to this utterance.
+    void append(const std::string& voskJson);
+    // Regenerates `json` from text and words (after editing them directly).
+    void rebuildJson();
+};
+
+// Whole-buffer speech recognition, implemented by each ASR backend.
+class AsrEngine {
+public:
+    virtual ~AsrEngine() = default;
+
+    // "vosk", "whisper"
+    virtual const char* name() const = 0;
+    virtual bool isAvailable() const = 0;
+    virtual std::string lastError() const = 0;
+
+    // Decodes a mono 16-bit PCM buffer once and returns text, word timings,
+    // confidences and the raw JSON.
+    virtual AsrResult recognize(const std::vector<int16_t>& pcm, double sampleRate) = 0;
+
+    // Transcribes a mono 16-bit PCM audio buffer.
+    virtual std::string transcribe(const std::vector<int16_t>& pcm, double sampleRate) {
+        return recognize(pcm, sampleRate).text;
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "AsrVosk.h"
+#include "AudioConditioner.h"
+#include "Resampler.h"
+
+class CommandGrammar;
+
+struct AsrSessionStats {
+    double audioSeconds = 0.0;    // audio decoded this utterance, at the ASR rate
+    double decodeSeconds = 0.0;   // wall time spent inside the recognizer
+    double finishMs = 0.0;        // finish() call -> final transcript
+    uint64_t partials = 0;        // partial results reported
+    bool commandFastPath = false; // transcript came from the command grammar
+    bool commandPrefix = false;   // command words from the grammar, body from the full decode
+};
+
+// Streaming recognition of one utterance at a time.
+//
+// feed() only queues the captured chunk; a worker thread converts it to the
+// ASR rate, conditions it and decodes it while the user is still talking.
+// By the time finish() is called only the last few frames and the final
+// lattice pass are left, so the transcript is ready within tens of
+// milliseconds of end of speech instead of after a full-buffer decode.
+//
+// With a CommandGrammar, the conditioned audio is also decoded on a second
+// thread by a recognizer restricted to the command phrases. If that result
+// is accepted, finish() returns it without the full recognizer's final pass.
+//
+// The workers, their recognizers and the conversion state persist across
+// utterances; open() just rewinds them (and picks up a rebuilt grammar).
+class AsrSession {
+public:
+    // Called on the worker thread whenever the partial hypothesis changes.
+    using PartialCallback = std::function<void(const std::string& partial)>;
+
+    explicit AsrSession(AsrVosk& asr, const ConditionerConfig& cond = ConditionerConfig(),
+                        const CommandGrammar* commands = nullptr);
+    ~AsrSession();
+
+    AsrSession(const AsrSession&) = delete;
+    AsrSession& operator=(const AsrSession&) = delete;
+
+    bool isAvailable() const { return available_; }
+    const std::string& lastError() const { return lastError_; }
+
+    // Set before open(); not thread-safe with respect to a running utterance.
+    void setPartialCallback(PartialCallback cb) { onPartial_ = std::move(cb); }
+
+    // Starts a new utterance captured at sampleRate, dropping any unfinished one.
+    bool open(double sampleRate);
+    bool isOpen() const { return open_; }
+
+    // Queues captured audio. Cheap: never decodes on the caller's thread.
+    void feed(const int16_t* pcm, size_t samples);
+
+    // Decodes what is still queued, returns the transcript and closes the utterance.
+    std::string finish();
+
+    // Drops the utterance without decoding the rest.
+    void cancel();
+
+    // Words, timings and JSON of the last finish().
+    const AsrResult& result() const { return result_; }
+    AsrSessionStats stats() const;
+    // Per-stage cost of the conditioning run on the worker; call after
+    // finish(), reset by open().
+    std::string conditionerStatsLine() const;
+
+private:
+    struct CommandLane;
+
+    void run();
+    void decode(const int16_t* pcm, size_t samples);
+    void accept(const int16_t* pcm, size_t samples);
+    void finalize();
+
+    AsrVosk& asr_;
+    bool available_ = false;
+    std::string lastError_;
+    PartialCallback onPartial_;
+    bool open_ = false;
+
+    // Shared with the worker.
+    mutable std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    std::vector<int16_t> pending_;
+    double rate_ = 0.0;
+    bool rewindRequested_ = false;
+    bool finishRequested_ = false;
+    bool finished_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+
+    // Worker-only state (read by the caller once finish() has returned).
+    AsrVosk::Recognizer rec_;
+    StreamResampler resampler_;
+    AudioConditioner conditioner_;
+    std::vector<int16_t> converted_, conditioned_;
+    AsrResult current_;
+    std::string lastPartial_;
+    size_t sinceLastPartial_ = 0;
+    AsrResult result_;
+    AsrSessionStats stats_;
+    std::unique_ptr<CommandLane> lane_;
+};
@@ -3,32 +3,89 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "AsrEngine.h"
 
 // Forward declare Vosk types to avoid including the header here
 // for projects that build without WITH_VOSK.
 struct VoskModel;
+struct VoskRecognizer;
 
-class AsrVosk {
+class AsrVosk : public AsrEngine {
 public:
+    // Rate the models are trained on; other rates are converted first.
+    static constexpr double kSampleRate = 16000.0;
+
     AsrVosk(const std::string& modelDir);
-    ~AsrVosk();
+    ~AsrVosk() override;
+
+    const char* name() const override { return "vosk"; }
 
     // Returns true if the Vosk model was loaded successfully.
-    bool isAvailable() const;
+    bool isAvailable() const override;
+
+    // Decodes a mono 16-bit PCM buffer once and returns text, word timings,
+    // confidences and the raw JSON.
+    AsrResult recognize(const std::vector<int16_t>& pcm, double sampleRate) override;
 
     // Transcribes a mono 16-bit PCM audio buffer.
-    std::string transcribe(const std::vector<int16_t>& pcm, double sampleRate);
+    std::string transcribe(const std::vector<int16_t>& pcm, double sampleRate) override;
 
     // Returns the last error message, if any.
-    std::string lastError() const;
+    std::string lastError() const override;
 
     // Transcribes and returns the full JSON result from Vosk.
     std::string transcribe_and_get_full_json(const std::vector<int16_t>& pcm, double sampleRate);
 
+#ifdef WITH_VOSK
+    // Shared model, for auxiliary recognizers (e.g. wake-word spotting).
+    VoskModel* model() const { return model_; }
+
+    // A full-vocabulary recognizer (word timings enabled) borrowed from this
+    // model's pool. It goes back to the pool, reset, when the lease dies.
+    class Recognizer {
+    public:
+        Recognizer() = default;
+        Recognizer(AsrVosk* owner, VoskRecognizer* rec, int rate) : owner_(owner), rec_(rec), rate_(rate) {}
+        ~Recognizer() { release(); }
+        Recognizer(Recognizer&& o) noexcept { *this = std::move(o); }
+        Recognizer& operator=(Recognizer&& o) noexcept;
+        Recognizer(const Recognizer&) = delete;
+        Recognizer& operator=(const Recognizer&) = delete;
+
+        VoskRecognizer* get() const { return rec_; }
+        explicit operator bool() const { return rec_ != nullptr; }
+        void release();
+
+    private:
+        AsrVosk* owner_ = nullptr;
+        VoskRecognizer* rec_ = nullptr;
+        int rate_ = 0;
+    };
+
+    // Reuses an idle recognizer for this rate or creates one. Thread-safe.
+    Recognizer acquireRecognizer(double sampleRate = kSampleRate);
+
+    // Recognizers created so far (pool misses).
+    size_t recognizersCreated() const;
+
+    // recognize() on a recognizer the caller already holds (e.g. one per
+    // worker thread). It is reset afterwards and stays with the caller.
+    AsrResult recognize(const Recognizer& rec, const std::vector<int16_t>& pcm, double sampleRate);
+#endif
+
 private:
     // PImpl idiom would be cleaner, but this is simple enough.
 #ifdef WITH_VOSK
+    void releaseRecognizer(VoskRecognizer* rec, int rate);
+
     VoskModel* model_ = nullptr;
+    mutable std::mutex poolMutex_;
+    std::map<int, std::vector<VoskRecognizer*>> pool_;  // idle recognizers by sample rate
+    size_t created_ = 0;
 #endif
     bool is_available_ = false;
     std::string last_error_;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+#include "AsrEngine.h"
+
+struct whisper_context;
+
+struct WhisperConfig {
+    std::string modelPath;      // ggml model; quantized ones (e.g. ggml-base-q5_1.bin) load the same way
+    int threads = 0;            // 0: one per hardware thread, up to 8
+    std::string language = "fr";  // "auto" to detect
+    bool vadTrim = true;        // decode only from first to last voiced frame
+    int beamSize = 0;           // 0: greedy sampling
+    bool useGpu = false;
+};
+
+// In-process whisper.cpp recognizer. The model is loaded once; calls to
+// recognize() are serialised on its single decoding state.
+class AsrWhisper : public AsrEngine {
+public:
+    static constexpr double kSampleRate = 16000.0;
+
+    explicit AsrWhisper(const WhisperConfig& cfg);
+    ~AsrWhisper() override;
+
+    AsrWhisper(const AsrWhisper&) = delete;
+    AsrWhisper& operator=(const AsrWhisper&) = delete;
+
+    const char* name() const override { return "whisper"; }
+    bool isAvailable() const override { return ctx_ != nullptr; }
+    std::string lastError() const override;
+
+    // Words carry token-level timings; conf is the mean token probability.
+    AsrResult recognize(const std::vector<int16_t>& pcm, double sampleRate) override;
+
+    const WhisperConfig& config() const { return cfg_; }
+
+private:
+    WhisperConfig cfg_;
+    whisper_context* ctx_ = nullptr;
+    mutable std::mutex mutex_;
+    std::string lastError_;
+};
+
+// True for the ASR_ENGINE values that select this backend ("whisper", "whispercpp").
+bool isWhisperEngine(const std::string& engine);
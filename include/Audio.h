@@ -7,6 +7,9 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <functional>
+
+#include "AudioCapture.h"
 
 #ifdef WITH_AUDIO
 // Forward declaration
@@ -21,6 +24,11 @@ struct AudioDeviceInfo {
     double defaultSampleRate;
     std::vector<double> supportedSampleRates;
 };
+
+// Receives fixed-size frames drained from the capture ring, on the recording
+// thread (never on the PortAudio callback). Return false to stop recording.
+// The last frame may be shorter when recording stops mid-frame.
+using FrameSink = std::function<bool(const int16_t* frame, size_t samples)>;
 #endif
 
 class Audio {
@@ -39,6 +47,32 @@ public:
     bool record(int deviceId, int seconds, double& sampleRate, std::vector<int16_t>& buffer);
     bool recordPtt(int deviceId, int maxSeconds, double& sampleRate, std::vector<int16_t>& buffer);
     bool playback(int deviceId, double sampleRate, const std::vector<int16_t>& buffer);
+
+    // Callback-driven push-to-talk capture: streams frameMs frames to sink
+    // until Enter is pressed, maxSeconds elapse or the sink returns false.
+    bool recordFrames(int deviceId, int maxSeconds, double& sampleRate, int frameMs,
+                      const FrameSink& sink, CaptureStats* stats = nullptr);
+
+    // Same, on an already open capture stream (kept open afterwards). Audio
+    // from its pre-roll window is delivered ahead of the live frames.
+    bool recordFrames(AudioCapture& capture, int maxSeconds, int frameMs,
+                      const FrameSink& sink, CaptureStats* stats = nullptr);
+
+    // Picks the preferred rate if the device supports it, else a standard one.
+    static double pickSupportedRate(PaDeviceIndex dev, bool isOutput, double preferredRate);
+
+    // Returns the subset of `rates` the device supports for mono int16.
+    // Answers come from the on-disk rate cache; only unseen rates are probed.
+    static std::vector<double> probeRates(PaDeviceIndex dev, bool isOutput, const std::vector<double>& rates);
+
+    // Rate cache location (default: data/audio_devices.json).
+    static void setRateCachePath(const std::string& path);
+
+    // Drops cached answers for a device, e.g. after a stream failed to open.
+    static void forgetDevice(PaDeviceIndex dev);
+
+    // Drops every cached answer (--refresh-audio-cache).
+    static void clearRateCache();
 #endif
 
     // Test tone generation
@@ -52,6 +86,5 @@ private:
 #ifdef WITH_AUDIO
     // Helper for checking sample rates
     static std::vector<double> getSupportedSampleRates(const PaDeviceInfo* deviceInfo);
-    static double pickSupportedRate(PaDeviceIndex dev, bool isOutput, double preferredRate);
 #endif
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#ifdef WITH_AUDIO
+#include <portaudio.h>
+#endif
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "RingBuffer.h"
+
+// Counters exposed by the callback-driven capture path.
+struct CaptureStats {
+    uint64_t samplesCaptured = 0;  // samples delivered by the device
+    uint64_t samplesDropped = 0;   // samples lost because the ring was full
+    uint64_t overruns = 0;         // callbacks that could not write all their samples
+    uint64_t deviceOverflows = 0;  // paInputOverflow flags reported by PortAudio
+};
+
+#ifdef WITH_AUDIO
+// Mono 16-bit input stream fed by a PortAudio callback.
+//
+// The callback never allocates or locks: it copies each device buffer into a
+// preallocated SPSC ring. A single consumer thread drains the ring in
+// fixed-size frames with readFrame()/waitFrame().
+//
+// The stream can stay open between utterances: while disarmed, the callback
+// only keeps a rolling pre-roll window of the most recent audio. arm() puts
+// that window in the ring ahead of the live audio, so the first syllable
+// spoken just before the trigger is not lost.
+class AudioCapture {
+public:
+    AudioCapture();
+    ~AudioCapture();
+
+    AudioCapture(const AudioCapture&) = delete;
+    AudioCapture& operator=(const AudioCapture&) = delete;
+
+    // Opens the device. sampleRate is the preferred rate on input and the
+    // negotiated rate on output. ringSeconds sizes the ring buffer.
+    bool open(int deviceId, double& sampleRate, double ringSeconds = 4.0);
+
+    // Length of the rolling pre-roll window; takes effect on the next open().
+    void setPreRollMs(int ms) { preRollMs_ = ms; }
+    int preRollMs() const { return preRollMs_; }
+
+    // arm(): deliver the pre-roll window, then live audio, to the ring.
+    // disarm(): stop feeding the ring and drop what it holds; only the
+    // pre-roll window is kept. A freshly opened stream is armed.
+    void arm();
+    void disarm();
+    bool isArmed() const { return mode_.load() == kArmed; }
+
+    bool start();
+    void stop();
+    void close();
+
+    bool isOpen() const { return stream_ != nullptr; }
+    bool isRunning() const { return running_; }
+    double sampleRate() const { return sampleRate_; }
+
+    // Samples currently buffered in the ring.
+    size_t available() const { return ring_.readAvailable(); }
+
+    // Reads exactly n samples if that many are buffered; returns false otherwise.
+    bool readFrame(int16_t* dst, size_t n);
+
+    // Like readFrame(), but waits up to timeoutMs for the frame to fill.
+    bool waitFrame(int16_t* dst, size_t n, int timeoutMs);
+
+    // Reads whatever is buffered, up to maxSamples.
+    size_t read(int16_t* dst, size_t maxSamples) { return ring_.read(dst, maxSamples); }
+
+    // Drops everything currently buffered.
+    void discard() { ring_.clear(); }
+
+    CaptureStats stats() const;
+    void resetStats();
+
+private:
+    static int paCallback(const void* input, void* output, unsigned long frameCount,
+                          const PaStreamCallbackTimeInfo* timeInfo,
+                          PaStreamCallbackFlags statusFlags, void* userData);
+
+    enum Mode { kArmed, kIdle, kArmRequested, kDisarmRequested };
+    void waitForMode(int mode);
+    void pushPreRoll(const int16_t* in, size_t n);
+    void flushPreRoll();
+
+    PaStream* stream_ = nullptr;
+    bool running_ = false;
+    double sampleRate_ = 0.0;
+    SpscRing<int16_t> ring_;
+
+    // Pre-roll window, only touched by the callback while the stream runs.
+    int preRollMs_ = 0;
+    std::vector<int16_t> preRoll_;
+    size_t preRollPos_ = 0;
+    size_t preRollFill_ = 0;
+    std::atomic<int> mode_{kArmed};
+
+    std::atomic<uint64_t> samplesCaptured_{0};
+    std::atomic<uint64_t> samplesDropped_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> deviceOverflows_{0};
+};
+#endif // WITH_AUDIO
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include <cstddef>
+
+// Stages of the pre-ASR conditioning pipeline, applied in this order.
+struct ConditionerConfig {
+    bool highPass = true;            // removes DC, rumble and mains hum
+    double highPassHz = 80.0;
+    bool noiseSuppression = false;   // spectral (Wiener) suppression of stationary noise
+    double maxReductionDb = 15.0;    // deepest attenuation applied to a noise-only bin
+    bool agc = false;                // slow automatic gain control on voiced frames
+    double agcTargetDb = -23.0;      // target level, dBFS RMS
+    double agcMaxGainDb = 20.0;
+    double agcGateDb = -50.0;        // frames quieter than this leave the gain alone
+
+    bool anyEnabled() const { return highPass || noiseSuppression || agc; }
+};
+
+// Parses a stage list such as "hpf,ns,agc" or "none" into cfg.
+// Returns false (cfg untouched) on an unknown stage name.
+bool parseConditionerStages(const std::string& list, ConditionerConfig& cfg);
+
+// CPU spent in one stage.
+struct StageStats {
+    uint64_t samples = 0;    // samples processed
+    double cpuSeconds = 0.0;
+
+    // Cost per 10 ms of audio at the given rate.
+    double usPer10ms(double sampleRate) const {
+        return samples ? cpuSeconds * 1e6 / (samples / (sampleRate / 100.0)) : 0.0;
+    }
+};
+
+struct ConditionerStats {
+    StageStats highPass;
+    StageStats noise;
+    StageStats agc;
+};
+
+// Frame-based conditioning between capture and ASR. Feed consecutive chunks
+// of any size; converted audio is appended to `out`. Noise suppression works
+// on overlapping FFT frames and delays its output by latencySamples(); call
+// flush() at the end of the utterance to get the tail.
+class AudioConditioner {
+public:
+    explicit AudioConditioner(const ConditionerConfig& cfg = ConditionerConfig());
+
+    const ConditionerConfig& config() const { return cfg_; }
+
+    // Starts a new utterance (filter state, noise estimate and gain persist
+    // only across chunks of one stream).
+    void reset();
+
+    void process(const int16_t* in, size_t samples, double sampleRate, std::vector<int16_t>& out);
+    void flush(std::vector<int16_t>& out);
+
+    // process() + flush() on a complete buffer.
+    std::vector<int16_t> processBuffer(const std::vector<int16_t>& pcm, double sampleRate);
+
+    size_t latencySamples() const;
+
+    const ConditionerStats& stats() const { return stats_; }
+    void resetStats() { stats_ = ConditionerStats(); }
+
+    // "[cond] hpf 0.4 us, ns 21.0 us, agc 0.6 us per 10 ms frame"
+    std::string statsLine() const;
+
+private:
+    void configure(double sampleRate);
+    void highPass(float* x, size_t n);
+    void noiseSuppress(const float* in, size_t n, std::vector<float>& out);
+    void noiseFrame();
+    void applyAgc(float* x, size_t n);
+    void emit(const float* x, size_t n, std::vector<int16_t>& out);
+
+    ConditionerConfig cfg_;
+    ConditionerStats stats_;
+    double rate_ = 0.0;
+
+    // High-pass biquad (transposed direct form II).
+    float b0_ = 1, b1_ = 0, b2_ = 0, a1_ = 0, a2_ = 0;
+    float z1_ = 0, z2_ = 0;
+
+    // Noise suppression: sqrt-Hann analysis/synthesis, 50% overlap.
+    size_t fftSize_ = 0, hop_ = 0;
+    std::vector<float> window_;
+    std::vector<std::complex<float>> twiddles_;
+    std::vector<uint32_t> bitrev_;
+    std::vector<float> frameIn_;                // last fftSize_ input samples
+    size_t frameFill_ = 0;                      // new samples since the last frame
+    std::vector<float> ola_;                    // overlap-add accumulator
+    std::vector<std::complex<float>> spec_;
+    std::vector<float> power_, noisePsd_, gain_, prevPost_;
+    uint64_t nsFrames_ = 0;
+    uint64_t nsIn_ = 0, nsOut_ = 0;             // samples into / out of the suppressor
+    size_t nsSkip_ = 0;                         // leading padding still to drop
+
+    // AGC
+    double agcGainDb_ = 0.0;                    // after the last full block
+    double agcFromDb_ = 0.0;                    // start of the ramp across the current block
+    double agcEnergy_ = 0.0;                    // of the current block so far
+    size_t agcFill_ = 0;
+    size_t agcBlock_ = 0;
+
+    std::vector<float> scratch_, nsOutBuf_;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#ifdef WITH_AUDIO
+#include <portaudio.h>
+#endif
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "RingBuffer.h"
+#include "Resampler.h"
+
+// Counters exposed by the streaming playback engine.
+struct PlaybackStats {
+    uint64_t samplesQueued = 0;   // samples accepted by enqueue()
+    uint64_t samplesPlayed = 0;   // samples handed to the device
+    uint64_t samplesFlushed = 0;  // samples dropped by flush()
+    uint64_t underruns = 0;       // callbacks that ran dry while more audio was announced
+};
+
+#ifdef WITH_AUDIO
+// Persistent mono 16-bit output stream fed from a PCM queue.
+//
+// The stream stays open between clips; callers enqueue() chunks at any time,
+// including while earlier chunks are still playing. The PortAudio callback
+// is the only consumer of the queue and plays silence when it is empty.
+class AudioPlayer {
+public:
+    AudioPlayer();
+    ~AudioPlayer();
+
+    AudioPlayer(const AudioPlayer&) = delete;
+    AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+    // Opens and starts the output stream. preferredRate is used if the device
+    // supports it; bufferSeconds bounds how much audio can be queued.
+    bool open(int deviceId, double preferredRate, double bufferSeconds = 30.0);
+    void close();
+
+    bool isOpen() const { return stream_ != nullptr; }
+    double sampleRate() const { return sampleRate_; }
+
+    // Queues PCM recorded at `rate`, resampling to the stream rate if needed.
+    // Blocks only while the queue is full. Set `more` when further chunks of
+    // the same utterance will follow, so that starving in between counts as an
+    // underrun. Returns false if the player is closed or flushed meanwhile.
+    bool enqueue(const int16_t* pcm, size_t samples, double rate, bool more = false);
+    bool enqueue(const std::vector<int16_t>& pcm, double rate, bool more = false) {
+        return enqueue(pcm.data(), pcm.size(), rate, more);
+    }
+
+    // Drops everything still queued; audio stops within one device buffer.
+    void flush();
+
+    // Waits until all queued audio has been played (timeoutMs < 0: forever).
+    bool waitIdle(int timeoutMs = -1);
+
+    // True while queued audio has not been played yet.
+    bool isPlaying() const;
+
+    // Seconds of audio played / still queued.
+    double playedSeconds() const;
+    double queuedSeconds() const;
+
+    PlaybackStats stats() const;
+
+private:
+    static int paCallback(const void* input, void* output, unsigned long frameCount,
+                          const PaStreamCallbackTimeInfo* timeInfo,
+                          PaStreamCallbackFlags statusFlags, void* userData);
+
+    PaStream* stream_ = nullptr;
+    double sampleRate_ = 0.0;
+    SpscRing<int16_t> ring_;
+
+    // Producer-side conversion to the stream rate (enqueue() thread only).
+    StreamResampler resampler_;
+    std::vector<int16_t> resampled_;
+    bool resamplerContinues_ = false;
+    uint64_t resamplerGeneration_ = 0;
+
+    std::atomic<bool> flushRequested_{false};
+    std::atomic<bool> expectMore_{false};
+    std::atomic<uint64_t> flushGeneration_{0};
+    std::atomic<uint64_t> samplesQueued_{0};
+    std::atomic<uint64_t> samplesPlayed_{0};
+    std::atomic<uint64_t> samplesFlushed_{0};
+    std::atomic<uint64_t> underruns_{0};
+};
+#endif // WITH_AUDIO
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AudioCapture.h"
+#include "AudioPlayer.h"
+
+// Devices and formats requested for a session. Rates are preferences: the
+// negotiated values are reported by inputRate()/outputRate().
+struct AudioSessionConfig {
+    int inputDevice = -1;             // -1: default input device
+    int outputDevice = -1;            // -1: default output device
+    bool withInput = true;
+    bool withOutput = true;
+    double inputRate = 16000.0;
+    double outputRate = 48000.0;
+    int preRollMs = 500;
+    double captureRingSeconds = 4.0;
+    double playbackBufferSeconds = 30.0;
+};
+
+#ifdef WITH_AUDIO
+// Input and output streams negotiated once and kept open for the lifetime of
+// a conversation, so that a turn costs no rate probing and no stream setup.
+//
+// The capture stream is left started and disarmed (only the pre-roll window
+// runs); the playback stream is started and plays silence until fed.
+class AudioSession {
+public:
+    AudioSession() = default;
+    ~AudioSession() { close(); }
+
+    AudioSession(const AudioSession&) = delete;
+    AudioSession& operator=(const AudioSession&) = delete;
+
+    // Fails only if the input was requested and could not be opened; a missing
+    // output device is reported and leaves hasOutput() false.
+    bool open(const AudioSessionConfig& cfg);
+    void close();
+
+    bool hasInput() const { return capture_.isOpen(); }
+    bool hasOutput() const { return player_.isOpen(); }
+    double inputRate() const { return capture_.sampleRate(); }
+    double outputRate() const { return player_.sampleRate(); }
+
+    AudioCapture& capture() { return capture_; }
+    AudioPlayer& player() { return player_; }
+
+    // Wall time spent negotiating and opening both streams.
+    double setupMs() const { return setupMs_; }
+
+private:
+    AudioCapture capture_;
+    AudioPlayer player_;
+    double setupMs_ = 0.0;
+};
+#endif // WITH_AUDIO
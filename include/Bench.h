@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+#include "WakeWord.h"
+
+class AsrVosk;
+
+// Built-in micro-benchmarks, reachable from the CLI (--bench-*).
+// Each returns a process exit code.
+
+#ifdef WITH_VOSK
+// Runs the wake-word detector over idle audio (a WAV file, or `seconds` of
+// synthetic room noise when wavPath is empty) and reports CPU cost,
+// extrapolated to one hour of listening.
+int runWakeWordBench(AsrVosk& asr, const WakeWordConfig& cfg, const std::string& wavPath, int seconds);
+#endif
+
+// Converts `seconds` of synthetic audio for each "in:out" rate pair in
+// `pairs` (comma separated; empty: the pairs used in practice) with the
+// former linear interpolator, the generic polyphase kernel and the kernel the
+// resampler selects for that pair, and reports throughput in input samples
+// per second plus alias rejection.
+int runResampleBench(const std::string& pairs, int seconds);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+class AsrVosk;
+class MemoryStore;
+struct AsrResult;
+
+// Restricted Vosk grammar for the commands parseIntent() understands.
+//
+// Closed-form commands ("set <key> <value>" over the known fact keys and a
+// small value vocabulary) are listed as whole phrases. Free-text commands
+// (notes, reminders) only contribute their spoken prefix: their body
+// decodes as [unk], so they never take the fast path, but a confidently
+// heard prefix replaces a misheard one in the full decode (see
+// spliceFreeText). Words missing from the model's vocabulary are dropped
+// with their phrase.
+class CommandGrammar {
+public:
+    explicit CommandGrammar(AsrVosk& asr, double minConfidence = 0.85);
+
+    // Rebuilds the phrase list if the store's facts changed since the last
+    // call. Returns true when the grammar changed.
+    bool update(const MemoryStore& mem);
+
+    // Vosk grammar (JSON array of phrases) and its version, bumped on every
+    // rebuild. Safe to call from any thread.
+    std::string grammar(uint64_t& version) const;
+    size_t phraseCount() const;
+    bool empty() const { return phraseCount() == 0; }
+
+    // A grammar result wins over the full decode when it is an in-grammar
+    // command (no [unk]) that parseIntent() accepts and every word is at
+    // least minConfidence.
+    bool accepts(const AsrResult& result) const;
+    double minConfidence() const { return minConfidence_; }
+
+    // When `command` opens with a free-text command prefix followed by
+    // [unk] and `full` does not parse as that command, rewrites `full` as
+    // the prefix plus the full decode's words after it. True if rewritten.
+    bool spliceFreeText(const AsrResult& command, AsrResult& full) const;
+
+private:
+    AsrVosk& asr_;
+    double minConfidence_;
+    uint64_t factsRevision_ = 0;
+    bool built_ = false;
+
+    mutable std::mutex mutex_;
+    std::string json_ = "[]";
+    size_t phrases_ = 0;
+    uint64_t version_ = 0;
+};
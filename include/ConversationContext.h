@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+#include "OpenAIClient.h"
+
+struct ContextConfig {
+    std::string systemPrompt = OpenAIClient::kSystemPrompt;
+    size_t maxTokens = 1024;   // prompt budget: system + history + new message; 0: no history
+    double trimTo = 0.5;       // once over budget, drop the oldest turns down to this share of it
+};
+
+// Bounded conversation history for the LLM.
+//
+// Each request is the system prompt, the kept turns and the new message.
+// Turns are stored exactly as sent and received, and appended at the end,
+// so consecutive requests share a byte-identical prefix and the server can
+// reuse its KV cache for everything but the newest turn. When the estimated
+// prompt exceeds the budget, the oldest turns are dropped in one go down to
+// `trimTo` of it, rather than one per turn: the prefix then changes once
+// and stays stable again for the following turns.
+//
+// Token counts are estimated from UTF-8 bytes; the ratio is calibrated from
+// the prompt_tokens the server reports.
+class ConversationContext {
+public:
+    explicit ConversationContext(const ContextConfig& cfg = ContextConfig());
+
+    // Messages for the next request with `userMessage`, trimming old turns first if needed.
+    std::vector<ChatMessage> messagesFor(const std::string& userMessage);
+
+    // Records a completed exchange. promptTokens is the server's count for
+    // the request built by the last messagesFor() (0 if unknown).
+    void commit(const std::string& userMessage, const std::string& reply, int promptTokens = 0);
+
+    void clear() { turns_.clear(); }
+
+    size_t turns() const { return turns_.size(); }
+    // The newest kept turn, user message then reply; empty without history.
+    std::string lastExchange() const;
+    // Estimated size of the last prompt built by messagesFor().
+    size_t promptEstimate() const { return promptEstimate_; }
+    // Turns dropped by the last messagesFor(): the server's prompt cache starts over.
+    size_t lastEvicted() const { return lastEvicted_; }
+    uint64_t totalEvicted() const { return totalEvicted_; }
+
+    size_t estimateTokens(const std::string& text) const;
+
+private:
+    struct Turn {
+        std::string user;
+        std::string assistant;
+    };
+
+    size_t turnTokens(const Turn& t) const;
+
+    ContextConfig cfg_;
+    std::deque<Turn> turns_;
+    double bytesPerToken_ = 3.5;
+    size_t promptBytes_ = 0;      // content bytes of the last prompt
+    size_t promptMessages_ = 0;
+    size_t promptEstimate_ = 0;
+    size_t lastEvicted_ = 0;
+    uint64_t totalEvicted_ = 0;
+};
@@ -11,6 +11,9 @@ struct EnvConfig {
     std::string wakeWord = "jarvis";
     std::string asrEngine = "disabled";
     std::string ttsEngine = "disabled";
+    std::string whisperModel;      // ASR_ENGINE=whisper: ggml model path
+    int whisperThreads = 0;        // 0: automatic
+    int piperThreads = 0;          // TTS_ENGINE=piper-inproc: onnxruntime threads, 0: automatic
 };
 
 // Charge un fichier .env (format KEY=VALUE, lignes, # pour commentaires).
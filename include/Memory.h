@@ -17,6 +17,9 @@ public:
   bool get(const std::string& key, std::string& value) const;
   bool del(const std::string& key);
   std::vector<std::pair<std::string,std::string>> listFacts() const;
+  // Bumped whenever the facts may have changed (set/del/load/fromJson/clear),
+  // so derived data such as the ASR command grammar knows when to rebuild.
+  uint64_t factsRevision() const { return factsRevision_; }
 
   // notes
   std::string addNote(const std::string& text);
@@ -33,12 +36,14 @@ public:
   void fromJson(const nlohmann::json& j, bool merge = false) {
       if (merge) j_.merge_patch(j);
       else j_ = j;
+      ++factsRevision_;
   }
-  void clear() { j_.clear(); }
+  void clear() { j_.clear(); ++factsRevision_; }
 
 private:
   std::string path_;
   nlohmann::json j_; // { "version":1, "facts":{...}, "notes":[...], "reminders":[...] }
+  uint64_t factsRevision_ = 0;
   bool ensureParentDir() const; // create data/ if missing
   static std::string genId();   // e.g. timestamp + random
 };
@@ -1,23 +1,139 @@
-
 #pragma once
 #include <string>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <vector>
+
+struct ChatMessage {
+    std::string role;       // "system", "user" or "assistant"
+    std::string content;
+};
 
 struct ChatResult {
     bool ok = false;
     std::string text;     // assistant content or raw response
     std::string error;    // error message if any
+
+    // Filled in by chatStream().
+    double firstTokenMs = -1.0;   // request sent -> first content delta (< 0: none)
+    int tokens = 0;               // completion tokens (server usage, else one per delta)
+    int promptTokens = 0;         // from the server's usage, 0 if not reported
+    int cachedTokens = 0;         // prompt tokens the server reused from its prefix cache, if reported
+    double tokensPerSec = 0.0;    // tokens after the first one, over the generation time
+
+    // HTTP timings, from the start of the request.
+    double totalMs = 0.0;         // -> end of the response
+    double connectMs = 0.0;       // -> connection ready (TCP, plus TLS for https); 0 when reused
+    double ttfbMs = 0.0;          // -> first response byte
+    bool reusedConnection = false;
+    int httpVersion = 0;          // 1 (HTTP/1.x) or 2
+
+    bool cancelled = false;       // aborted through ChatHandle::cancel(); text holds what arrived
+    bool timedOut = false;        // deadline passed; text holds what arrived
+};
+
+// An LLM request running on its own thread (see OpenAIClient::chatAsync).
+// Destroying or reassigning a handle whose request is still running cancels
+// it and waits for the thread to finish.
+class ChatHandle {
+public:
+    ChatHandle() = default;
+    ChatHandle(ChatHandle&&) noexcept = default;
+    ChatHandle& operator=(ChatHandle&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            cancel_ = std::move(other.cancel_);
+            future_ = std::move(other.future_);
+        }
+        return *this;
+    }
+    ~ChatHandle() { abandon(); }
+
+    bool valid() const { return future_.valid(); }
+    bool ready() const { return waitFor(0); }
+    // True once the result is available; waits at most `ms`.
+    bool waitFor(int ms) const {
+        return future_.wait_for(std::chrono::milliseconds(ms)) == std::future_status::ready;
+    }
+    // Blocks until the request completes. Once per handle.
+    ChatResult get() { return future_.get(); }
+    // Aborts the transfer, mid-stream if it is streaming; get() then returns
+    // a result with `cancelled` set. Takes effect within about a second.
+    void cancel() { if (cancel_) cancel_->store(true); }
+
+private:
+    friend class OpenAIClient;
+
+    void abandon() {
+        if (!future_.valid()) return;
+        cancel();
+        future_.wait();
+    }
+
+    std::shared_ptr<std::atomic<bool>> cancel_;
+    std::future<ChatResult> future_;
 };
 
 class OpenAIClient {
 public:
-    OpenAIClient(std::string apiBase, std::string apiKey, std::string model, bool offline = false);
+    static constexpr const char* kSystemPrompt = "You are a concise assistant. Reply in the user's language.";
+
+    // Receives each piece of assistant text as soon as it is decoded.
+    using DeltaFn = std::function<void(const std::string& delta)>;
+
+    struct ChatOptions {
+        bool stream = true;
+        double timeoutSeconds = -1.0;                     // deadline for the whole reply; < 0: client default, 0: none
+        DeltaFn onDelta;                                  // streamed text, on the request thread
+        std::function<void(const ChatResult&)> onDone;    // on the request thread, before the handle is ready
+    };
+
+    // The client keeps one connection to the endpoint open across requests
+    // (HTTP keep-alive, with DNS and TLS sessions cached), so only the first
+    // turn pays for connection setup. With http2, https endpoints negotiate
+    // HTTP/2; plain http stays on HTTP/1.1.
+    OpenAIClient(std::string apiBase, std::string apiKey, std::string model, bool offline = false, bool http2 = true);
+    ~OpenAIClient();
+
+    OpenAIClient(const OpenAIClient&) = delete;
+    OpenAIClient& operator=(const OpenAIClient&) = delete;
 
     // one-shot prompt => assistant reply (non-streaming)
     ChatResult chatOnce(const std::string& userMessage) const;
+    // Same with a whole conversation, e.g. from ConversationContext::messagesFor().
+    ChatResult chatOnce(const std::vector<ChatMessage>& messages) const;
+
+    // Same request with "stream": true. Server-sent events are parsed inside
+    // the curl write callback and every content delta is passed to onDelta
+    // while the reply is still being generated; the returned result holds the
+    // whole text plus first-token latency and throughput.
+    ChatResult chatStream(const std::string& userMessage, const DeltaFn& onDelta) const;
+    ChatResult chatStream(const std::vector<ChatMessage>& messages, const DeltaFn& onDelta) const;
+
+    // Starts the request on its own thread and returns at once, so the
+    // caller can keep capturing audio and cancel() the reply if the user
+    // interrupts it. Requests share one connection and run one at a time.
+    // The client must outlive the handle.
+    ChatHandle chatAsync(const std::string& userMessage, ChatOptions opts) const;
+    ChatHandle chatAsync(std::vector<ChatMessage> messages, ChatOptions opts) const;
+
+    // Deadline for every request without its own; 0 disables it.
+    void setTimeout(double seconds) { m_timeoutSeconds = seconds; }
+    double timeout() const { return m_timeoutSeconds; }
 
 private:
+    struct Connection;
+
+    ChatResult request(const std::vector<ChatMessage>& messages, bool stream, const DeltaFn& onDelta,
+                       const std::atomic<bool>* cancel, double timeoutSeconds) const;
+
     std::string m_apiBase;
     std::string m_apiKey;
     std::string m_model;
     bool m_offline;
+    double m_timeoutSeconds = 120.0;
+    std::unique_ptr<Connection> m_conn;
 };
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Polyphase windowed-sinc sample rate conversion.
+//
+// A conversion rateIn -> rateOut is treated as the rational ratio L/M (out/in,
+// reduced). Its low-pass prototype is split into `phases` sub-filters of
+// `taps` coefficients each, so every output sample costs one dot product of
+// `taps` input samples against one phase. The cutoff follows the lower of the
+// two rates, which keeps 48 kHz -> 16 kHz from aliasing into the speech band.
+struct PolyphaseBank {
+    int up = 1;              // L
+    int down = 1;            // M
+    int phases = 1;          // L, or fewer when L is very large (phase is then rounded)
+    int taps = 0;            // per phase, a multiple of 8 for the SIMD kernels
+    int history = 0;         // input samples each phase reaches back before the current one
+    std::vector<float> coeffs;  // phases * taps, phase-major
+
+    const float* phase(int p) const { return &coeffs[static_cast<size_t>(p) * taps]; }
+};
+
+// Returns the bank for rateIn -> rateOut. Banks are built on first use and
+// shared between callers; this is safe to call from any thread.
+std::shared_ptr<const PolyphaseBank> polyphaseBank(double rateIn, double rateOut);
+
+// Dot product of n floats (n a multiple of 8) with the widest vector kernel
+// this build supports.
+float dotProduct(const float* a, const float* b, size_t n);
+
+// "avx2", "sse2", "neon" or "scalar".
+const char* resamplerKernelName();
+
+// Chunk-at-a-time conversion of one continuous stream.
+//
+// The filter history is carried across calls, so converting a stream in
+// chunks of any size produces exactly the same samples as converting it in
+// one go, with no discontinuity at chunk boundaries. Output trails input by
+// latencySamples() input samples; flush() drains that tail at end of stream.
+//
+// The common rate pairs (48000->16000, 44100->16000, 22050->48000 and
+// 16000->48000) run on kernels specialised at compile time; any other pair
+// takes the generic path. Both produce the same samples.
+enum class ResamplerPath { Auto, Generic };
+
+class StreamResampler {
+public:
+    // Inner loop: converts from input position (idx, rem) up to maxOut
+    // outputs, stopping early when the lookahead is not buffered yet.
+    using Kernel = size_t (*)(const PolyphaseBank& bank, const float* buf, int64_t bufBase, int64_t bufEnd,
+                              int64_t& idx, uint64_t& rem, int16_t* out, size_t maxOut);
+
+    StreamResampler() = default;
+    StreamResampler(double rateIn, double rateOut) { configure(rateIn, rateOut); }
+
+    // Selects the rate pair and starts a new stream. Generic forces the
+    // runtime-parameterised kernel (for benchmarking).
+    void configure(double rateIn, double rateOut, ResamplerPath path = ResamplerPath::Auto);
+    // Starts a new stream with the same rates.
+    void reset();
+
+    bool isConfigured() const { return bank_ != nullptr; }
+    double rateIn() const { return rateIn_; }
+    double rateOut() const { return rateOut_; }
+    size_t latencySamples() const;
+    // Which kernel configure() selected, e.g. "fixed 48000->16000 (3:1 FIR)".
+    const char* kernelName() const { return kernelName_; }
+
+    // Most samples the next process() call can produce from `inSamples` more
+    // input (pending output included).
+    size_t maxOutput(size_t inSamples) const;
+
+    // Consumes all of `in` and writes up to `outCapacity` samples to `out`,
+    // returning how many were written. Output that did not fit is kept and
+    // returned by the next call.
+    size_t process(const int16_t* in, size_t inSamples, int16_t* out, size_t outCapacity);
+
+    // Appends the converted chunk to `out`.
+    void process(const int16_t* in, size_t inSamples, std::vector<int16_t>& out);
+
+    // End of stream: emits the remaining output (as if followed by silence),
+    // up to outCapacity, then resets.
+    size_t flush(int16_t* out, size_t outCapacity);
+    void flush(std::vector<int16_t>& out);
+
+private:
+    size_t produce(int16_t* out, size_t outCapacity, uint64_t limit);
+    size_t pendingOutput(uint64_t inputEnd) const;
+
+    std::shared_ptr<const PolyphaseBank> bank_;
+    Kernel kernel_ = nullptr;
+    const char* kernelName_ = "none";
+    double rateIn_ = 0.0, rateOut_ = 0.0;
+
+    // Input window as floats; buf_[0] is absolute input sample bufBase_.
+    std::vector<float> buf_;
+    int64_t bufBase_ = 0;
+    uint64_t inputSeen_ = 0;      // real (non-padding) input samples received
+    uint64_t outputDone_ = 0;     // output samples produced so far
+    int64_t idx_ = 0;             // input sample at or before the next output instant
+    uint64_t rem_ = 0;            // ... and the offset past it, in 1/L input samples
+};
+
+// Converts a complete mono buffer. Output length is samples * rateOut / rateIn.
+std::vector<int16_t> resamplePcm(const int16_t* pcm, size_t samples, double rateIn, double rateOut);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// Picks the lifetime of the entries whose normalized text contains `keyword`.
+struct ResponseCacheRule {
+    std::string keyword;
+    int ttlSeconds = 0;     // 0: never cached (the answer depends on the moment)
+};
+
+struct ResponseCacheConfig {
+    std::string path = "data/llm_cache.json";   // persistent tier; empty: memory only
+    size_t maxEntries = 256;
+    size_t maxBytes = 1u << 20;                 // questions + replies held in memory
+    int ttlSeconds = 24 * 3600;                 // entries matching no rule
+    // First match wins.
+    std::vector<ResponseCacheRule> rules = {
+        {"heure", 0}, {"time", 0}, {"maintenant", 0}, {"now", 0},
+        {"aujourd'hui", 0}, {"today", 0}, {"demain", 0}, {"tomorrow", 0}, {"date", 0},
+        {"temps", 1800}, {"météo", 1800}, {"weather", 1800},
+    };
+};
+
+struct ResponseCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bypassed = 0;      // questions a rule keeps out of the cache
+    uint64_t expired = 0;
+    uint64_t evictions = 0;     // entries dropped to stay within the limits
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    double hitRate() const {
+        const uint64_t total = hits + misses;
+        return total ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+// Replies to repeated questions, served without calling the LLM.
+//
+// Entries are keyed by the model, the system prompt, the normalized
+// question (case, spacing and punctuation ignored) and a hash of the
+// exchange that preceded it, so a follow-up such as "pourquoi ?" is only
+// answered after the same exchange. They are held in an LRU with a
+// per-entry TTL, and mirrored to a JSON file so they survive restarts.
+// Rules give time-sensitive questions a short lifetime or keep them out
+// entirely.
+class ResponseCache {
+public:
+    ResponseCache(const std::string& model, const std::string& systemPrompt,
+                  const ResponseCacheConfig& cfg = ResponseCacheConfig());
+
+    // True (and `reply` set) on a live entry for `question` after `context`
+    // (e.g. ConversationContext::lastExchange(), empty for a first question).
+    bool lookup(const std::string& question, const std::string& context, std::string& reply);
+    // Stores a successful reply, unless a rule bypasses the question.
+    void store(const std::string& question, const std::string& context, const std::string& reply);
+
+    // False when a rule keeps `question` out of the cache.
+    bool cacheable(const std::string& question) const;
+
+    ResponseCacheStats stats() const;
+    std::string statsLine() const;
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        std::string question;   // normalized; checked on every hit
+        uint64_t context = 0;   // hash of the preceding exchange, 0 for none
+        std::string reply;
+        int64_t expires = 0;    // unix seconds
+    };
+
+    int ttlFor(const std::string& normalized) const;
+    uint64_t keyFor(const std::string& normalized, uint64_t context) const;
+    void insert(Entry e);
+    void erase(std::list<Entry>::iterator it);
+    void load();
+    void save() const;
+
+    ResponseCacheConfig cfg_;
+    std::string scope_;         // model + system prompt, part of every key
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;      // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    ResponseCacheStats stats_;
+};
+
+// Lowercases ASCII, unifies apostrophes and turns other punctuation into
+// collapsed whitespace, so transcripts of the same question share an entry.
+std::string normalizeQuestion(const std::string& text);
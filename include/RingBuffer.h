@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+// Lock-free single-producer / single-consumer ring buffer.
+//
+// The producer (typically a PortAudio callback) only calls write(); the
+// consumer only calls read(), peek(), skip() and clear(). Storage is allocated
+// once by reset() and never grows, so neither side allocates on the hot path.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 0) { reset(capacity); }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // (Re)allocates the storage. Not thread-safe: call only while neither
+    // the producer nor the consumer is running.
+    void reset(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        buf_.assign(capacity > 0 ? cap : 0, T{});
+        mask_ = capacity > 0 ? cap - 1 : 0;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return buf_.size(); }
+
+    // Number of elements ready to be read (consumer side).
+    size_t readAvailable() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+    }
+
+    // Number of free slots (producer side).
+    size_t writeAvailable() const {
+        return buf_.size() - (head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire));
+    }
+
+    // Producer: copies up to n elements, returns how many were written.
+    size_t write(const T* src, size_t n) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t count = std::min(n, buf_.size() - (head - tail));
+        copyIn(head, src, count);
+        head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: copies up to n elements without consuming them.
+    size_t peek(T* dst, size_t n) const {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t count = std::min(n, head - tail);
+        copyOut(tail, dst, count);
+        return count;
+    }
+
+    // Consumer: copies and consumes up to n elements.
+    size_t read(T* dst, size_t n) {
+        const size_t count = peek(dst, n);
+        tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: drops up to n elements.
+    size_t skip(size_t n) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t count = std::min(n, head_.load(std::memory_order_acquire) - tail);
+        tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: drops everything currently buffered.
+    void clear() { skip(readAvailable()); }
+
+private:
+    void copyIn(size_t pos, const T* src, size_t n) {
+        if (n == 0) return;
+        const size_t start = pos & mask_;
+        const size_t first = std::min(n, buf_.size() - start);
+        std::memcpy(&buf_[start], src, first * sizeof(T));
+        if (n > first) std::memcpy(&buf_[0], src + first, (n - first) * sizeof(T));
+    }
+
+    void copyOut(size_t pos, T* dst, size_t n) const {
+        if (n == 0) return;
+        const size_t start = pos & mask_;
+        const size_t first = std::min(n, buf_.size() - start);
+        std::memcpy(dst, &buf_[start], first * sizeof(T));
+        if (n > first) std::memcpy(dst + first, &buf_[0], (n - first) * sizeof(T));
+    }
+
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+    // Monotonic counters; kept on separate cache lines to avoid false sharing.
+    alignas(64) std::atomic<size_t> head_{0}; // advanced by the producer
+    alignas(64) std::atomic<size_t> tail_{0}; // advanced by the consumer
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "TtsEngine.h"
+
+struct TtsCacheConfig {
+    std::string dir = "data/tts_cache";   // on-disk tier; empty: memory only
+    size_t memoryBytes = 32u << 20;       // in-memory LRU tier
+    size_t diskBytes = 256u << 20;        // oldest files are pruned past this
+};
+
+struct TtsCacheStats {
+    uint64_t memoryHits = 0;
+    uint64_t diskHits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;     // entries dropped from the memory tier
+    size_t memoryEntries = 0;
+    size_t memoryBytes = 0;
+    size_t diskBytes = 0;
+
+    uint64_t hits() const { return memoryHits + diskHits; }
+    double hitRate() const {
+        const uint64_t total = hits() + misses;
+        return total ? static_cast<double>(hits()) / total : 0.0;
+    }
+};
+
+// Content-addressed cache in front of another TTS engine.
+//
+// Entries are keyed by a hash of the engine's voiceKey() (model, settings,
+// output rate) and the normalized text, so changing the voice or the device
+// rate never replays stale audio. Hits come from an in-memory LRU, then from
+// raw PCM files under `dir`; misses are synthesized by the engine and stored
+// in both tiers. Replies are cached per sentence when the engine is driven
+// by a TtsPipeline, so recurring confirmations hit even inside longer replies.
+class TtsCache : public TtsEngine {
+public:
+    TtsCache(std::unique_ptr<TtsEngine> engine, const TtsCacheConfig& cfg = TtsCacheConfig());
+
+    const char* name() const override { return engine_->name(); }
+    bool isAvailable() const override { return engine_->isAvailable(); }
+    const std::string& lastError() const override { return engine_->lastError(); }
+    std::vector<int16_t> synthesize(const std::string& text, double& sampleRate) override;
+    void setOutputRate(double rate) override;
+    std::string voiceKey() const override { return engine_->voiceKey(); }
+
+    // Synthesizes (or loads) each phrase so its first use is a memory hit.
+    // Returns the number of phrases that had to be synthesized.
+    size_t prewarm(const std::vector<std::string>& phrases);
+
+    TtsCacheStats stats() const;
+    std::string statsLine() const;
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        std::string id;         // voice key + text, checked on every hit
+        std::vector<int16_t> pcm;
+        double rate = 0.0;
+    };
+
+    bool lookup(uint64_t key, const std::string& id, std::vector<int16_t>& pcm, double& rate);
+    void insertMemory(uint64_t key, const std::string& id, const std::vector<int16_t>& pcm, double rate);
+    void storeDisk(uint64_t key, const std::string& id, const std::vector<int16_t>& pcm, double rate);
+    void pruneDisk();
+    std::string pathFor(uint64_t key) const;
+
+    std::unique_ptr<TtsEngine> engine_;
+    TtsCacheConfig cfg_;
+    std::string voiceKey_;
+
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_;   // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    TtsCacheStats stats_;
+};
+
+// Collapses whitespace and unifies apostrophes, so trivially different
+// spellings of a phrase share one cache entry.
+std::string normalizeTtsText(const std::string& text);
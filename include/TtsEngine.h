@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Text-to-speech, implemented by each TTS backend.
+class TtsEngine {
+public:
+    virtual ~TtsEngine() = default;
+
+    // "piper", "piper-inproc"
+    virtual const char* name() const = 0;
+    virtual bool isAvailable() const = 0;
+    virtual const std::string& lastError() const = 0;
+
+    // Synthesizes `text` to mono 16-bit PCM. sampleRate receives the rate of
+    // the returned buffer: the output rate if one is set, else the voice's.
+    virtual std::vector<int16_t> synthesize(const std::string& text, double& sampleRate) = 0;
+
+    // If set (> 0), synthesize() converts the voice to this rate, e.g. the
+    // output device rate, instead of returning the model's native rate.
+    virtual void setOutputRate(double rate) { outputRate_ = rate; }
+
+    // Identifies the voice and every setting that changes the audio, so that
+    // cached audio is only reused for identical synthesis.
+    virtual std::string voiceKey() const {
+        return std::string(name()) + "|rate=" + std::to_string(static_cast<long>(outputRate_));
+    }
+
+protected:
+    double outputRate_ = 0.0;
+};
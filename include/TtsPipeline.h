@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+class TtsEngine;
+
+struct TtsPipelineStats {
+    size_t chunks = 0;            // chunks synthesized and handed to the sink
+    size_t failed = 0;            // chunks the engine returned no audio for
+    double firstAudioMs = -1.0;   // begin() -> first chunk handed to the sink (< 0: none)
+    double totalMs = 0.0;         // begin() -> last chunk handed to the sink
+    double synthMs = 0.0;         // time spent inside the engine
+    double audioSeconds = 0.0;    // audio produced
+};
+
+// Moves the complete sentences (or, in long sentences, clauses) at the
+// front of `buffer` to `chunks`. A boundary is only taken once the next
+// character is known, so text can be appended as it arrives; with `final`
+// the rest of the buffer is flushed too. Returns the number of chunks added.
+size_t takeSpeechChunks(std::string& buffer, std::vector<std::string>& chunks, bool final);
+
+// Splits a whole reply into speech chunks.
+std::vector<std::string> splitForSpeech(const std::string& text);
+
+// Sentence-pipelined synthesis of one reply at a time.
+//
+// push() splits text into sentences and queues them; a worker thread
+// synthesizes them in order and hands each one to the sink as soon as it is
+// ready, so the first sentence plays while the next ones are synthesized.
+// The sink's `more` flag is set while further chunks of the reply will
+// follow (see AudioPlayer::enqueue); the reply ends with a last call that
+// has `more` false, possibly with no samples.
+class TtsPipeline {
+public:
+    // Called on the worker thread. Returning false cancels the rest of the reply.
+    using Sink = std::function<bool(const std::vector<int16_t>& pcm, double sampleRate, bool more)>;
+
+    TtsPipeline(TtsEngine& tts, Sink sink);
+    ~TtsPipeline();
+
+    TtsPipeline(const TtsPipeline&) = delete;
+    TtsPipeline& operator=(const TtsPipeline&) = delete;
+
+    // Keeps a copy of the whole reply for audio(), e.g. to save it as a WAV.
+    void setKeepAudio(bool keep) { keepAudio_ = keep; }
+
+    // Starts a reply, dropping whatever is left of the previous one.
+    void begin();
+    // Appends reply text; complete sentences are queued right away.
+    void push(const std::string& text);
+    // No more text for this reply: queues what is left of it.
+    void end();
+    // Waits until the reply has been handed to the sink.
+    TtsPipelineStats wait();
+    // Drops the rest of the reply; the chunk being synthesized is discarded.
+    void cancel();
+
+    TtsPipelineStats speak(const std::string& text) {
+        begin();
+        push(text);
+        end();
+        return wait();
+    }
+
+    // Valid after wait(), with setKeepAudio(true).
+    const std::vector<int16_t>& audio() const { return audio_; }
+    double sampleRate() const { return sampleRate_; }
+    std::string lastError() const;
+
+private:
+    void run();
+    bool idleLocked() const { return ended_ && queue_.empty() && !busy_ && !pendingMore_; }
+
+    TtsEngine& tts_;
+    Sink sink_;
+    bool keepAudio_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_, done_;
+    std::deque<std::string> queue_;
+    std::string text_;            // pushed text not yet split into chunks
+    uint64_t generation_ = 0;     // bumped by begin()/cancel()
+    bool ended_ = true;
+    bool busy_ = false;
+    bool pendingMore_ = false;    // last chunk went out with more=true
+    bool stop_ = false;
+    std::chrono::steady_clock::time_point start_;
+    TtsPipelineStats stats_;
+    std::vector<int16_t> audio_;
+    double sampleRate_ = 0.0;
+    std::string lastError_;
+    std::thread worker_;
+};
@@ -3,15 +3,48 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <mutex>
 
-class TtsPiper {
+#include "TtsEngine.h"
+
+// Piper TTS through one long-lived `piper --json-input --output_raw` process.
+//
+// The voice is loaded once, when the worker starts in the constructor; each
+// synthesize() then writes one JSON line to its stdin and reads the raw
+// 16-bit mono PCM back from its stdout, with no temporary files. Piper logs
+// its real-time factor on stderr once an utterance has been written out,
+// which marks the end of the audio. Calls are serialized on the worker; a
+// worker that dies or stalls is restarted by the next call.
+class TtsPiper : public TtsEngine {
 public:
     TtsPiper(const std::string& modelPath, const std::string& piperBin = "piper");
-    bool isAvailable() const;
-    std::vector<int16_t> synthesize(const std::string& text, double& sampleRate);
-    const std::string& lastError() const;
+    ~TtsPiper() override;
+
+    TtsPiper(const TtsPiper&) = delete;
+    TtsPiper& operator=(const TtsPiper&) = delete;
+
+    const char* name() const override { return "piper"; }
+    // Model and binary were found (checked once, in the constructor).
+    bool isAvailable() const override;
+    std::vector<int16_t> synthesize(const std::string& text, double& sampleRate) override;
+    const std::string& lastError() const override;
+    std::string voiceKey() const override;
+
+    // Native rate of the voice, from the model's .onnx.json.
+    double voiceRate() const { return voiceRate_; }
 
 private:
+    bool startWorker();
+    void stopWorker();
+    bool readUtterance(std::vector<int16_t>& pcm);
+
     std::string bin_, model_;
+    bool available_ = false;
+    double voiceRate_ = 22050.0;
     mutable std::string lastErr_;
+
+    std::mutex mutex_;
+    int pid_ = -1;
+    int stdin_ = -1, stdout_ = -1, stderr_ = -1;
+    std::string stderrLine_;
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "TtsEngine.h"
+
+struct PiperInprocConfig {
+    std::string modelPath;          // voice .onnx, with its .onnx.json next to it
+    std::string espeakData = "piper/bin/espeak-ng-data";
+    int threads = 0;                // onnxruntime intra-op threads; 0: up to 4 cores
+    int speaker = 0;                // multi-speaker voices only
+    double sentenceSilence = 0.2;   // seconds of silence between sentences
+};
+
+// Piper voices run inside the assistant: text is phonemized with
+// piper_phonemize (espeak-ng) and the VITS model is run by onnxruntime.
+// The session is created once and reused by every call; the float output is
+// scaled straight to 16-bit PCM without any process or WAV round trip.
+// Calls are serialized, since espeak-ng keeps global state.
+class TtsPiperInproc : public TtsEngine {
+public:
+    explicit TtsPiperInproc(const PiperInprocConfig& cfg);
+    ~TtsPiperInproc() override;
+
+    TtsPiperInproc(const TtsPiperInproc&) = delete;
+    TtsPiperInproc& operator=(const TtsPiperInproc&) = delete;
+
+    const char* name() const override { return "piper-inproc"; }
+    bool isAvailable() const override { return voice_ != nullptr; }
+    const std::string& lastError() const override { return lastErr_; }
+    std::vector<int16_t> synthesize(const std::string& text, double& sampleRate) override;
+    std::string voiceKey() const override;
+
+    double voiceRate() const { return voiceRate_; }
+
+private:
+    struct Voice;
+
+    PiperInprocConfig cfg_;
+    std::unique_ptr<Voice> voice_;
+    double voiceRate_ = 22050.0;
+    std::mutex mutex_;
+    std::string lastErr_;
+};
+
+// True for the TTS_ENGINE values that select this backend.
+bool isPiperInprocEngine(const std::string& engine);
@@ -12,7 +12,11 @@ std::string extractJsonStringField(const std::string& json, const std::string& f
 
 std::string join(const std::vector<std::string>& items, const std::string& sep);
 
-#ifdef WITH_VOSK
+// "<size>:<mtime>" of a file, or "" if it does not exist; changes whenever
+// the file is replaced, e.g. to tell two versions of a model apart.
+std::string fileStamp(const std::string& path);
+
+#if defined(WITH_VOSK) || defined(WITH_WHISPER)
 // Loads a WAV file into a mono 16-bit PCM audio buffer.
 // Returns false if the file cannot be loaded or is not mono/16-bit.
 bool loadWav(
@@ -22,7 +26,8 @@ bool loadWav(
 );
 #endif
 
-// Resamples a PCM audio buffer from a source to a target sample rate.
+// Resamples a PCM audio buffer from a source to a target sample rate
+// (polyphase windowed-sinc, see Resampler.h).
 std::vector<int16_t> resample(
     const std::vector<int16_t>& pcm_in,
     double sample_rate_in,
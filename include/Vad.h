@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Tuning knobs for the frame-based voice activity detector.
+struct VadConfig {
+    int hangoverMs = 700;            // trailing silence that ends an utterance
+    int minSpeechMs = 200;           // shorter bursts are treated as noise
+    double marginDb = 9.0;           // energy above the noise floor to count as speech
+    double minEnergyDb = -55.0;      // frames quieter than this (dBFS) are never speech
+    double maxZcr = 0.30;            // noise-like zero-crossing rate...
+    double strongMarginDb = 18.0;    // ...ignored when the frame is this loud
+};
+
+enum class VadEvent { None, SpeechStart, SpeechEnd };
+
+// Energy + zero-crossing voice activity detector with an adaptive noise
+// floor, a minimum speech length and a hangover before end of speech.
+// Feed consecutive frames (10-30 ms) of mono 16-bit PCM to process().
+class Vad {
+public:
+    explicit Vad(const VadConfig& cfg = VadConfig());
+
+    void reset();
+
+    // Classifies one frame and advances the endpointing state machine.
+    VadEvent process(const int16_t* frame, size_t samples, double sampleRate);
+
+    // Raw per-frame decision of the last process() call.
+    bool lastFrameIsSpeech() const { return lastSpeech_; }
+
+    // True between SpeechStart and SpeechEnd.
+    bool inSpeech() const { return inSpeech_; }
+
+    // True once any utterance has passed the minimum speech length.
+    bool hasSpeech() const { return speechFound_; }
+
+    // True once speech has started and the hangover has elapsed.
+    bool endpointed() const { return endpointed_; }
+
+    double speechMs() const { return speechMs_; }
+    double noiseFloorDb() const { return noiseDb_; }
+
+    // Frame features, exposed for callers that want their own decision.
+    static double energyDb(const int16_t* frame, size_t samples);
+    static double zeroCrossingRate(const int16_t* frame, size_t samples);
+
+    // Offline check: does the buffer contain at least one utterance?
+    static bool containsSpeech(const std::vector<int16_t>& pcm, double sampleRate,
+                               const VadConfig& cfg = VadConfig(), int frameMs = 10);
+
+private:
+    VadConfig cfg_;
+    double noiseDb_ = 0.0;
+    bool noiseInit_ = false;
+    bool lastSpeech_ = false;
+    bool inSpeech_ = false;
+    bool speechFound_ = false;
+    bool endpointed_ = false;
+    double runSpeechMs_ = 0.0;   // consecutive speech in the current burst
+    double runSilenceMs_ = 0.0;  // consecutive silence since the last speech frame
+    double speechMs_ = 0.0;      // total speech in confirmed utterances
+};
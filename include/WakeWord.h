@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Vad.h"
+
+class AsrVosk;
+struct VoskRecognizer;
+
+struct WakeWordConfig {
+    std::string word = "jarvis";   // one or more words, e.g. "hey jarvis"
+    double minConfidence = 0.65;   // stage 2: per-word Vosk confidence
+    double minWordSeconds = 0.15;  // stage 2: reject implausibly short matches
+    int leadInMs = 300;            // audio kept before the gate opens
+    int gateSilenceMs = 300;       // silence that closes the gate
+    int maxBurstMs = 2500;         // longest burst sent to the spotter
+};
+
+struct WakeWordStats {
+    uint64_t framesSeen = 0;      // frames handed to process()
+    uint64_t framesDecoded = 0;   // frames that passed the energy gate
+    uint64_t bursts = 0;          // gated bursts decoded by the spotter
+    uint64_t candidates = 0;      // bursts where the grammar matched the wake word
+    uint64_t detections = 0;      // candidates accepted by the confirmation stage
+};
+
+// Two-stage wake-word spotter meant to run on every capture frame.
+//
+// Stage 1 is a VAD energy gate: silent frames cost one energy/ZCR pass and
+// never reach Kaldi. Voiced bursts (plus a short lead-in) are decoded by a
+// Vosk recognizer whose grammar only contains the wake word and [unk].
+// Stage 2 confirms a grammar match with the per-word confidence and
+// duration reported by Vosk before reporting a detection.
+class WakeWordDetector {
+public:
+    WakeWordDetector(AsrVosk& asr, const WakeWordConfig& cfg = WakeWordConfig());
+    ~WakeWordDetector();
+
+    WakeWordDetector(const WakeWordDetector&) = delete;
+    WakeWordDetector& operator=(const WakeWordDetector&) = delete;
+
+    bool isAvailable() const { return available_; }
+    const std::string& lastError() const { return lastError_; }
+
+    // Feeds one capture frame; returns true when the wake word is confirmed.
+    bool process(const int16_t* frame, size_t samples, double sampleRate);
+
+    // Drops any partial burst (e.g. after our own TTS played).
+    void reset();
+
+    double lastConfidence() const { return lastConfidence_; }
+    WakeWordStats stats() const { return stats_; }
+
+private:
+    bool ensureRecognizer(double sampleRate);
+    void pushLeadIn(const int16_t* frame, size_t samples);
+    bool finishBurst();
+    bool confirm(const std::string& resultJson);
+
+    AsrVosk& asr_;
+    WakeWordConfig cfg_;
+    std::vector<std::string> words_;
+    Vad gate_;
+    VoskRecognizer* rec_ = nullptr;
+    double recRate_ = 0.0;
+    bool available_ = false;
+    std::string lastError_;
+
+    bool gateOpen_ = false;
+    double burstMs_ = 0.0;
+    double silenceMs_ = 0.0;
+    std::vector<int16_t> leadIn_;  // circular, leadInMs of audio
+    size_t leadInPos_ = 0;
+    size_t leadInFill_ = 0;
+    double lastConfidence_ = 0.0;
+    WakeWordStats stats_;
+};
@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# Resampler throughput (polyphase vs. the old linear interpolator) on 60 s of
+# synthetic audio per rate pair. Build with -DWITH_NATIVE_ARCH=ON to get the
+# AVX2/NEON kernels instead of the SSE2/scalar baseline.
+./build/home_assistant --bench-resample "${1:-48000:16000,44100:16000,22050:48000}" --bench-seconds 60
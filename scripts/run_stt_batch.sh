@@ -0,0 +1,7 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# Re-transcribe a directory of captures (e.g. --loop-save-wavs output) with one
+# shared model on all cores. Results go to a JSONL file, one object per WAV.
+: "${VOSK_MODEL_DIR:?Set VOSK_MODEL_DIR to your model path}"
+./build/home_assistant --stt-batch "${1:-captures}" --stt-out "${2:-captures/stt_batch.jsonl}" \
+  --vosk-model "$VOSK_MODEL_DIR" --stt-threads "${STT_THREADS:-0}"
@@ -0,0 +1,7 @@
+#!/usr/bin/env bash
+set -euo pipefail
+: "${VOSK_MODEL_DIR:?Set VOSK_MODEL_DIR to your model path}"
+# CPU cost of the always-on wake-word spotter on 10 min of synthetic idle audio.
+# Pass a WAV recorded in the target room as $1 for a more realistic figure.
+./build/home_assistant --vosk-model "$VOSK_MODEL_DIR" \
+  --bench-wake "${1:-idle}" --bench-seconds 600
@@ -0,0 +1,316 @@
+#include "AsrBatch.h"
+#include "AsrVosk.h"
+#include "Resampler.h"
+#include "Utils.h"
+#include "Vad.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <limits>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#if __has_include(<filesystem>)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
+#include "nlohmann/json.hpp"
+
+#ifdef WITH_VOSK
+
+namespace {
+bool hasWavExtension(const std::filesystem::path& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c){ return std::tolower(c); });
+    return ext == ".wav";
+}
+
+// One output line, kept until every earlier file has been written.
+struct BatchSlot {
+    std::string line;
+    bool ready = false;
+};
+
+size_t workerCount(int requested, size_t jobs) {
+    size_t n = requested > 0 ? static_cast<size_t>(requested) : std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(n, jobs));
+}
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+}
+
+bool collectWavFiles(const std::string& input, std::vector<std::string>& files) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path root(input);
+    if (fs::is_directory(root, ec)) {
+        for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && hasWavExtension(it->path())) files.push_back(it->path().string());
+        }
+    } else if (fs::is_regular_file(root, ec)) {
+        if (hasWavExtension(root)) {
+            files.push_back(input);
+        } else {
+            // A list of paths, one per line.
+            std::ifstream list(input);
+            std::string line;
+            while (std::getline(list, line)) {
+                line = trim(line);
+                if (!line.empty() && line[0] != '#') files.push_back(line);
+            }
+        }
+    } else {
+        std::cerr << "[batch] No such file or directory: " << input << std::endl;
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    return true;
+}
+
+int runBatchTranscription(AsrVosk& asr, const AsrBatchConfig& cfg) {
+    std::vector<std::string> files;
+    if (!collectWavFiles(cfg.input, files)) return 1;
+    if (files.empty()) {
+        std::cerr << "[batch] No WAV files found in " << cfg.input << std::endl;
+        return 1;
+    }
+    std::ofstream out(cfg.outputPath);
+    if (!out) {
+        std::cerr << "[batch] Could not write to " << cfg.outputPath << std::endl;
+        return 1;
+    }
+
+    const size_t threads = workerCount(cfg.threads, files.size());
+    std::cout << "[batch] " << files.size() << " files, " << threads << " workers" << std::endl;
+
+    std::vector<BatchSlot> slots(files.size());
+    std::atomic<size_t> nextFile{0};
+    std::mutex outMutex;
+    size_t written = 0;
+    size_t failed = 0;
+    double audioSeconds = 0.0;
+    double decodeSeconds = 0.0;
+
+    auto worker = [&]() {
+        // One recognizer per worker for the whole run; only the model is shared.
+        AsrVosk::Recognizer rec = asr.acquireRecognizer(AsrVosk::kSampleRate);
+        AudioConditioner conditioner(cfg.cond);
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            nlohmann::json j;
+            j["file"] = files[i];
+            double seconds = 0.0;
+            AsrResult r;
+            std::vector<int16_t> pcm;
+            uint32_t rate = 0;
+            if (!rec) {
+                j["error"] = "recognizer unavailable";
+            } else if (!loadWav(files[i], pcm, rate)) {
+                j["error"] = "could not load WAV";
+            } else {
+                seconds = rate ? static_cast<double>(pcm.size()) / rate : 0.0;
+                if (cfg.cond.anyEnabled()) {
+                    conditioner.reset();
+                    pcm = conditioner.processBuffer(pcm, rate);
+                }
+                r = asr.recognize(rec, pcm, rate);
+                j["text"] = r.text;
+                j["confidence"] = r.confidence();
+                j["audio_s"] = seconds;
+                j["decode_ms"] = r.decodeMs;
+                j["words"] = nlohmann::json::array();
+                for (const auto& w : r.words) {
+                    j["words"].push_back({{"word", w.word}, {"start", w.start}, {"end", w.end}, {"conf", w.conf}});
+                }
+            }
+
+            std::lock_guard<std::mutex> lk(outMutex);
+            slots[i].line = j.dump();
+            slots[i].ready = true;
+            if (j.contains("error")) ++failed;
+            audioSeconds += seconds;
+            decodeSeconds += r.decodeMs / 1000.0;
+            while (written < slots.size() && slots[written].ready) {
+                out << slots[written].line << '\n';
+                std::string().swap(slots[written].line);
+                if (++written % 100 == 0) {
+                    std::cout << "[batch] " << written << "/" << files.size() << " files" << std::endl;
+                }
+            }
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) pool.emplace_back(worker);
+    for (auto& th : pool) th.join();
+    double wall = secondsSince(t0);
+    out.flush();
+
+    std::cout << "[batch] " << files.size() << " files (" << failed << " failed), "
+              << audioSeconds << " s of audio in " << wall << " s" << std::endl;
+    std::cout << "[batch] " << (wall > 0 ? files.size() / wall : 0.0) << " files/s, RTF "
+              << (audioSeconds > 0 ? wall / audioSeconds : 0.0) << " (wall), "
+              << (audioSeconds > 0 ? decodeSeconds / audioSeconds : 0.0) << " per worker" << std::endl;
+    std::cout << "[batch] Results written to " << cfg.outputPath << std::endl;
+    return failed == files.size() ? 1 : 0;
+}
+
+std::vector<AsrSegment> splitAtSilence(const std::vector<int16_t>& pcm, double sampleRate,
+                                       const AsrLongConfig& cfg, size_t workers) {
+    std::vector<AsrSegment> segments;
+    if (pcm.empty() || sampleRate <= 0) return segments;
+
+    // 10 ms frame energies, prefix-summed so any window's mean is O(1).
+    const size_t frame = std::max<size_t>(1, static_cast<size_t>(sampleRate / 100));
+    const size_t frames = pcm.size() / frame;
+    std::vector<double> prefix(frames + 1, 0.0);
+    for (size_t i = 0; i < frames; ++i) {
+        prefix[i + 1] = prefix[i] + Vad::energyDb(&pcm[i * frame], frame);
+    }
+
+    // Enough segments for every worker, but none too short to decode well.
+    const double total = pcm.size() / sampleRate;
+    double length = cfg.segmentSeconds;
+    if (workers > 1) length = std::min(length, std::max(5.0, total / workers));
+    const size_t lengthFrames = static_cast<size_t>(length * 100);
+    const size_t searchFrames = static_cast<size_t>(std::min(cfg.searchSeconds, length / 4) * 100);
+    const size_t window = 20;   // 200 ms: a pause, not a gap between two phonemes
+
+    std::vector<size_t> cuts;   // in samples
+    size_t start = 0;
+    while (frames > start + lengthFrames + searchFrames + window) {
+        const size_t lo = start + lengthFrames - searchFrames;
+        const size_t hi = start + lengthFrames + searchFrames;
+        size_t best = lo;
+        double bestSum = prefix[lo + window] - prefix[lo];
+        for (size_t c = lo + 1; c + window <= hi; ++c) {
+            double sum = prefix[c + window] - prefix[c];
+            if (sum < bestSum) {
+                bestSum = sum;
+                best = c;
+            }
+        }
+        start = best + window / 2;
+        cuts.push_back(start * frame);
+    }
+
+    const size_t overlap = static_cast<size_t>(cfg.overlapSeconds * sampleRate);
+    size_t ownBegin = 0;
+    for (size_t i = 0; i <= cuts.size(); ++i) {
+        AsrSegment seg;
+        seg.ownBegin = ownBegin;
+        seg.ownEnd = i < cuts.size() ? cuts[i] : pcm.size();
+        seg.begin = seg.ownBegin > overlap ? seg.ownBegin - overlap : 0;
+        seg.end = std::min(pcm.size(), seg.ownEnd + overlap);
+        segments.push_back(seg);
+        ownBegin = seg.ownEnd;
+    }
+    return segments;
+}
+
+AsrResult transcribeLong(AsrVosk& asr, const std::vector<int16_t>& pcm,
+                         const std::vector<AsrSegment>& segments, size_t workers,
+                         size_t* failedSegments) {
+    const double rate = AsrVosk::kSampleRate;
+    std::vector<AsrResult> parts(segments.size());
+    std::vector<char> decoded(segments.size(), 0);
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        // Without a recognizer, leave the segments to the other workers.
+        AsrVosk::Recognizer rec = asr.acquireRecognizer(rate);
+        if (!rec) {
+            std::cerr << "[long] Worker could not create a Vosk recognizer." << std::endl;
+            return;
+        }
+        std::vector<int16_t> chunk;
+        for (size_t i = next++; i < segments.size(); i = next++) {
+            chunk.assign(pcm.begin() + segments[i].begin, pcm.begin() + segments[i].end);
+            parts[i] = asr.recognize(rec, chunk, rate);
+            decoded[i] = 1;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < std::max<size_t>(1, std::min(workers, segments.size())); ++t) pool.emplace_back(worker);
+    for (auto& th : pool) th.join();
+    if (failedSegments) *failedSegments = static_cast<size_t>(std::count(decoded.begin(), decoded.end(), 0));
+
+    // Each word is kept by the segment that owns its midpoint, which drops
+    // the copy decoded a second time in the neighbour's overlap.
+    AsrResult out;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const double offset = segments[i].begin / rate;
+        const double ownBegin = segments[i].ownBegin / rate;
+        const double ownEnd = segments[i].ownEnd / rate;
+        const bool last = i + 1 == segments.size();
+        for (const AsrWord& w : parts[i].words) {
+            double mid = offset + 0.5 * (w.start + w.end);
+            if (mid < ownBegin || (last ? mid > ownEnd : mid >= ownEnd)) continue;
+            AsrWord word = w;
+            word.start += offset;
+            word.end += offset;
+            if (!out.text.empty()) out.text += ' ';
+            out.text += word.word;
+            out.words.push_back(std::move(word));
+        }
+        out.decodeMs += parts[i].decodeMs;
+    }
+    out.rebuildJson();
+    return out;
+}
+
+int runLongTranscription(AsrVosk& asr, const AsrLongConfig& cfg) {
+    std::vector<int16_t> pcm;
+    uint32_t rate = 0;
+    if (!loadWav(cfg.input, pcm, rate)) return 1;
+    if (pcm.empty() || rate == 0) {
+        std::cerr << "[long] Empty recording: " << cfg.input << std::endl;
+        return 1;
+    }
+    // Convert and condition once; segments are then plain slices.
+    if (rate != AsrVosk::kSampleRate) pcm = resamplePcm(pcm.data(), pcm.size(), rate, AsrVosk::kSampleRate);
+    if (cfg.cond.anyEnabled()) {
+        AudioConditioner conditioner(cfg.cond);
+        pcm = conditioner.processBuffer(pcm, AsrVosk::kSampleRate);
+    }
+
+    const double seconds = pcm.size() / AsrVosk::kSampleRate;
+    const size_t threads = workerCount(cfg.threads, std::numeric_limits<size_t>::max());
+    std::vector<AsrSegment> segments = splitAtSilence(pcm, AsrVosk::kSampleRate, cfg, threads);
+    std::cout << "[long] " << seconds << " s of audio, " << segments.size() << " segments, "
+              << std::min(threads, segments.size()) << " workers" << std::endl;
+
+    auto t0 = std::chrono::steady_clock::now();
+    size_t failed = 0;
+    AsrResult result = transcribeLong(asr, pcm, segments, threads, &failed);
+    double wall = secondsSince(t0);
+
+    std::cout << "Transcript: " << result.text << std::endl;
+    std::cout << "[long] Decoded in " << wall << " s: RTF " << wall / seconds
+              << ", speed-up x" << (wall > 0 ? result.decodeMs / 1000.0 / wall : 0.0)
+              << " over one recognizer" << std::endl;
+
+    if (!cfg.outputPath.empty()) {
+        std::ofstream out(cfg.outputPath);
+        if (!out) {
+            std::cerr << "Error: Could not write to JSON file: " << cfg.outputPath << std::endl;
+            return 1;
+        }
+        out << result.json;
+        std::cout << "[long] Dumped full JSON result to " << cfg.outputPath << std::endl;
+    }
+    if (failed > 0) {
+        std::cerr << "[long] " << failed << " of " << segments.size()
+                  << " segments were not decoded; the transcript is incomplete." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif // WITH_VOSK
@@ -0,0 +1,48 @@
+#include "AsrEngine.h"
+#include "nlohmann/json.hpp"
+
+double AsrResult::confidence() const {
+    if (words.empty()) return 0.0;
+    double sum = 0.0;
+    for (const auto& w : words) sum += w.conf;
+    return sum / words.size();
+}
+
+void AsrResult::append(const std::string& voskJson) {
+    auto j = nlohmann::json::parse(voskJson, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return;
+    std::string segment = j.value("text", "");
+    if (j.contains("result") && j["result"].is_array()) {
+        for (const auto& w : j["result"]) {
+            if (!w.is_object()) continue;
+            AsrWord word;
+            word.word = w.value("word", "");
+            word.start = w.value("start", 0.0);
+            word.end = w.value("end", 0.0);
+            word.conf = w.value("conf", 0.0);
+            words.push_back(std::move(word));
+        }
+    }
+    if (segment.empty()) {
+        if (json == "{}") json = j.dump();
+        return;
+    }
+    if (text.empty()) {
+        text = segment;
+        json = j.dump();
+        return;
+    }
+    // Second segment of the same utterance: rebuild one merged object.
+    text += " " + segment;
+    rebuildJson();
+}
+
+void AsrResult::rebuildJson() {
+    nlohmann::json merged;
+    merged["text"] = text;
+    merged["result"] = nlohmann::json::array();
+    for (const auto& w : words) {
+        merged["result"].push_back({{"word", w.word}, {"start", w.start}, {"end", w.end}, {"conf", w.conf}});
+    }
+    json = merged.dump();
+}
@@ -0,0 +1,334 @@
+#include "AsrSession.h"
+#include "CommandGrammar.h"
+#include <iostream>
+#include <chrono>
+#include "nlohmann/json.hpp"
+
+#ifdef WITH_VOSK
+#include <vosk_api.h>
+
+namespace {
+// Partial hypotheses are asked for at most this often (in ASR-rate samples);
+// each one costs a best-path search over the current lattice.
+constexpr size_t kPartialIntervalSamples = static_cast<size_t>(AsrVosk::kSampleRate / 4);
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+}
+
+// Second recognizer on the command grammar, fed the same conditioned audio
+// by the session worker and decoding on its own thread.
+struct AsrSession::CommandLane {
+    CommandLane(AsrVosk& asr, const CommandGrammar& grammar) : asr(asr), grammar(grammar) {
+        thread = std::thread(&CommandLane::run, this);
+    }
+    ~CommandLane() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        thread.join();
+        if (rec != nullptr) vosk_recognizer_free(rec);
+    }
+
+    void post(const int16_t* pcm, size_t samples) {
+        if (samples == 0) return;
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            pending.insert(pending.end(), pcm, pcm + samples);
+        }
+        wake.notify_one();
+    }
+
+    void postRewind() {
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            pending.clear();
+            rewind = true;
+        }
+        wake.notify_one();
+    }
+
+    AsrResult finish() {
+        std::unique_lock<std::mutex> lk(mutex);
+        finished = false;
+        finishing = true;
+        wake.notify_one();
+        done.wait(lk, [this] { return finished; });
+        return result;
+    }
+
+    void run() {
+        std::vector<int16_t> chunk;
+        std::unique_lock<std::mutex> lk(mutex);
+        for (;;) {
+            wake.wait(lk, [this] { return stop || rewind || finishing || !pending.empty(); });
+            if (stop) break;
+            if (rewind) {
+                rewind = false;
+                lk.unlock();
+                reload();
+                lk.lock();
+                continue;
+            }
+            chunk.swap(pending);
+            pending.clear();
+            bool fin = finishing;
+            lk.unlock();
+
+            if (rec != nullptr && !chunk.empty() &&
+                vosk_recognizer_accept_waveform_s(rec, chunk.data(), static_cast<int>(chunk.size())) == 1) {
+                current.append(vosk_recognizer_result(rec));
+            }
+            if (fin && rec != nullptr) current.append(vosk_recognizer_final_result(rec));
+
+            lk.lock();
+            if (fin) {
+                result = std::move(current);
+                current = AsrResult();
+                finishing = false;
+                finished = true;
+                done.notify_all();
+            }
+        }
+    }
+
+    // Starts a new utterance, switching to the latest grammar if it was rebuilt.
+    void reload() {
+        current = AsrResult();
+        uint64_t v = 0;
+        std::string json = grammar.grammar(v);
+        if (v == version) {
+            if (rec != nullptr) vosk_recognizer_reset(rec);
+            return;
+        }
+        version = v;
+        if (grammar.empty()) {
+            if (rec != nullptr) vosk_recognizer_free(rec);
+            rec = nullptr;
+        } else if (rec == nullptr) {
+            rec = vosk_recognizer_new_grm(asr.model(), static_cast<float>(AsrVosk::kSampleRate), json.c_str());
+            if (rec != nullptr) vosk_recognizer_set_words(rec, 1);
+        } else {
+            vosk_recognizer_set_grm(rec, json.c_str());
+        }
+    }
+
+    AsrVosk& asr;
+    const CommandGrammar& grammar;
+    VoskRecognizer* rec = nullptr;
+    uint64_t version = 0;
+    AsrResult current, result;
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::vector<int16_t> pending;
+    bool rewind = false, finishing = false, finished = false, stop = false;
+    std::thread thread;
+};
+
+AsrSession::AsrSession(AsrVosk& asr, const ConditionerConfig& cond, const CommandGrammar* commands)
+    : asr_(asr), conditioner_(cond) {
+    if (!asr_.isAvailable() || asr_.model() == nullptr) {
+        lastError_ = "Vosk model not available for streaming ASR.";
+        std::cerr << "[asr] " << lastError_ << std::endl;
+        return;
+    }
+    rec_ = asr_.acquireRecognizer(AsrVosk::kSampleRate);
+    if (!rec_) {
+        lastError_ = "Failed to create Vosk recognizer.";
+        std::cerr << "[asr] " << lastError_ << std::endl;
+        return;
+    }
+    available_ = true;
+    if (commands != nullptr) lane_ = std::make_unique<CommandLane>(asr_, *commands);
+    worker_ = std::thread(&AsrSession::run, this);
+}
+
+AsrSession::~AsrSession() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+bool AsrSession::open(double sampleRate) {
+    if (!available_ || sampleRate <= 0) return false;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        pending_.clear();
+        rate_ = sampleRate;
+        rewindRequested_ = true;
+        finishRequested_ = false;
+        stats_ = AsrSessionStats();
+    }
+    wake_.notify_one();
+    open_ = true;
+    return true;
+}
+
+void AsrSession::feed(const int16_t* pcm, size_t samples) {
+    if (!open_ || samples == 0) return;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        pending_.insert(pending_.end(), pcm, pcm + samples);
+    }
+    wake_.notify_one();
+}
+
+std::string AsrSession::finish() {
+    if (!open_) return "";
+    auto t0 = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lk(mutex_);
+    finished_ = false;
+    finishRequested_ = true;
+    wake_.notify_one();
+    done_.wait(lk, [this] { return finished_; });
+    stats_.finishMs = secondsSince(t0) * 1000.0;
+    open_ = false;
+    return result_.text;
+}
+
+void AsrSession::cancel() {
+    if (!open_) return;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        pending_.clear();
+        rewindRequested_ = true;
+    }
+    wake_.notify_one();
+    open_ = false;
+}
+
+AsrSessionStats AsrSession::stats() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+}
+
+std::string AsrSession::conditionerStatsLine() const {
+    return conditioner_.statsLine();
+}
+
+void AsrSession::run() {
+    std::vector<int16_t> chunk;
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        wake_.wait(lk, [this] { return stop_ || rewindRequested_ || finishRequested_ || !pending_.empty(); });
+        if (stop_) break;
+        if (rewindRequested_) {
+            // Anything already in pending_ was fed after open(): keep it.
+            rewindRequested_ = false;
+            double rate = rate_;
+            lk.unlock();
+            resampler_.configure(rate, AsrVosk::kSampleRate);
+            conditioner_.reset();
+            conditioner_.resetStats();
+            vosk_recognizer_reset(rec_.get());
+            current_ = AsrResult();
+            if (lane_) lane_->postRewind();
+            lastPartial_.clear();
+            sinceLastPartial_ = 0;
+            lk.lock();
+            continue;
+        }
+        chunk.swap(pending_);
+        pending_.clear();
+        bool finishing = finishRequested_;
+        lk.unlock();
+
+        decode(chunk.data(), chunk.size());
+        if (finishing) finalize();
+
+        lk.lock();
+        if (finishing) {
+            finishRequested_ = false;
+            finished_ = true;
+            done_.notify_all();
+        }
+    }
+}
+
+void AsrSession::decode(const int16_t* pcm, size_t samples) {
+    if (samples == 0) return;
+    converted_.clear();
+    resampler_.process(pcm, samples, converted_);
+    conditioned_.clear();
+    conditioner_.process(converted_.data(), converted_.size(), AsrVosk::kSampleRate, conditioned_);
+    if (lane_) lane_->post(conditioned_.data(), conditioned_.size());
+    accept(conditioned_.data(), conditioned_.size());
+}
+
+void AsrSession::accept(const int16_t* pcm, size_t samples) {
+    if (samples == 0) return;
+    auto t0 = std::chrono::steady_clock::now();
+    int endpoint = vosk_recognizer_accept_waveform_s(rec_.get(), pcm, static_cast<int>(samples));
+    double spent = secondsSince(t0);
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stats_.audioSeconds += samples / AsrVosk::kSampleRate;
+        stats_.decodeSeconds += spent;
+    }
+
+    if (endpoint == 1) {
+        // Vosk closed a segment at an internal pause; keep it and go on.
+        current_.append(vosk_recognizer_result(rec_.get()));
+        lastPartial_.clear();
+        sinceLastPartial_ = 0;
+        return;
+    }
+    if (!onPartial_) return;
+    sinceLastPartial_ += samples;
+    if (sinceLastPartial_ < kPartialIntervalSamples) return;
+    sinceLastPartial_ = 0;
+
+    auto j = nlohmann::json::parse(vosk_recognizer_partial_result(rec_.get()), nullptr, false);
+    std::string partial = j.is_object() ? j.value("partial", "") : "";
+    if (!partial.empty() && partial != lastPartial_) {
+        lastPartial_ = partial;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            ++stats_.partials;
+        }
+        onPartial_(current_.text.empty() ? partial : current_.text + " " + partial);
+    }
+}
+
+void AsrSession::finalize() {
+    // The tail still inside the resampler and the suppressor's FFT frame.
+    converted_.clear();
+    resampler_.flush(converted_);
+    conditioned_.clear();
+    conditioner_.process(converted_.data(), converted_.size(), AsrVosk::kSampleRate, conditioned_);
+    conditioner_.flush(conditioned_);
+    if (lane_) lane_->post(conditioned_.data(), conditioned_.size());
+    accept(conditioned_.data(), conditioned_.size());
+
+    // A confident command skips the large-vocabulary final pass; the full
+    // recognizer is reset at the next open() either way.
+    bool fastPath = false, prefixSpliced = false;
+    AsrResult command;
+    if (lane_) {
+        command = lane_->finish();
+        if (lane_->grammar.accepts(command)) {
+            current_ = std::move(command);
+            fastPath = true;
+        }
+    }
+    if (!fastPath) {
+        current_.append(vosk_recognizer_final_result(rec_.get()));
+        if (lane_) prefixSpliced = lane_->grammar.spliceFreeText(command, current_);
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    stats_.commandFastPath = fastPath;
+    stats_.commandPrefix = prefixSpliced;
+    current_.decodeMs = stats_.decodeSeconds * 1000.0;
+    result_ = std::move(current_);
+    current_ = AsrResult();
+}
+
+#endif // WITH_VOSK
@@ -1,13 +1,17 @@
 #include "AsrVosk.h"
-#include "Utils.h" // For resample and extractJsonStringField
+#include "Resampler.h"
 #include <iostream>
+#include <chrono>
 
 // Include Vosk API only when the build flag is enabled
 #ifdef WITH_VOSK
 #include <vosk_api.h>
 
 // Target sample rate for the Vosk models
-constexpr double VOSK_TARGET_SAMPLE_RATE = 16000.0;
+constexpr double VOSK_TARGET_SAMPLE_RATE = AsrVosk::kSampleRate;
+
+// Idle recognizers kept per rate; more only exist while borrowed concurrently.
+constexpr size_t kMaxIdleRecognizers = 8;
 
 // --- Implementation with Vosk enabled ---
 
@@ -23,6 +27,10 @@ AsrVosk::AsrVosk(const std::string& modelDir) {
 }
 
 AsrVosk::~AsrVosk() {
+    // Leases must not outlive the model they were created from.
+    for (auto& entry : pool_) {
+        for (VoskRecognizer* rec : entry.second) vosk_recognizer_free(rec);
+    }
     if (model_ != nullptr) {
         vosk_model_free(model_);
     }
@@ -36,71 +44,110 @@ std::string AsrVosk::lastError() const {
     return last_error_;
 }
 
-std::string AsrVosk::transcribe(const std::vector<int16_t>& pcm, double sampleRate) {
-    if (!is_available_) {
-        last_error_ = "Vosk model not available.";
-        return "";
+AsrVosk::Recognizer& AsrVosk::Recognizer::operator=(Recognizer&& o) noexcept {
+    if (this != &o) {
+        release();
+        owner_ = o.owner_;
+        rec_ = o.rec_;
+        rate_ = o.rate_;
+        o.owner_ = nullptr;
+        o.rec_ = nullptr;
     }
+    return *this;
+}
 
-    const std::vector<int16_t>* pcm_ptr = &pcm;
-    std::vector<int16_t> resampled_pcm;
+void AsrVosk::Recognizer::release() {
+    if (owner_ != nullptr && rec_ != nullptr) owner_->releaseRecognizer(rec_, rate_);
+    owner_ = nullptr;
+    rec_ = nullptr;
+}
 
-    // Resample if the source sample rate doesn't match the target
-    if (sampleRate != VOSK_TARGET_SAMPLE_RATE) {
-        resampled_pcm = resample(pcm, sampleRate, VOSK_TARGET_SAMPLE_RATE);
-        pcm_ptr = &resampled_pcm;
+AsrVosk::Recognizer AsrVosk::acquireRecognizer(double sampleRate) {
+    if (!is_available_) return Recognizer();
+    const int rate = static_cast<int>(sampleRate);
+    {
+        std::lock_guard<std::mutex> lk(poolMutex_);
+        auto& idle = pool_[rate];
+        if (!idle.empty()) {
+            VoskRecognizer* rec = idle.back();
+            idle.pop_back();
+            return Recognizer(this, rec, rate);
+        }
     }
-
-    // Create a recognizer for this specific transcription call
-    VoskRecognizer* recognizer = vosk_recognizer_new(model_, (float)VOSK_TARGET_SAMPLE_RATE);
-    if (recognizer == nullptr) {
-        last_error_ = "Failed to create Vosk recognizer.";
-        return "";
+    // Building the decoding graph state is the expensive part; do it unlocked.
+    VoskRecognizer* rec = vosk_recognizer_new(model_, static_cast<float>(rate));
+    if (rec == nullptr) return Recognizer();
+    vosk_recognizer_set_words(rec, 1);
+    {
+        std::lock_guard<std::mutex> lk(poolMutex_);
+        ++created_;
     }
+    return Recognizer(this, rec, rate);
+}
 
-    // Feed the PCM data to the recognizer
-    vosk_recognizer_accept_waveform_s(
-        recognizer,
-        pcm_ptr->data(),
-        pcm_ptr->size()
-    );
-
-    // Get the final result as a JSON string
-    const char* result_json = vosk_recognizer_final_result(recognizer);
-    std::string transcript = extractJsonStringField(result_json, "text");
-
-    // Clean up the recognizer for this call
-    vosk_recognizer_free(recognizer);
+void AsrVosk::releaseRecognizer(VoskRecognizer* rec, int rate) {
+    vosk_recognizer_reset(rec);
+    {
+        std::lock_guard<std::mutex> lk(poolMutex_);
+        auto& idle = pool_[rate];
+        if (idle.size() < kMaxIdleRecognizers) {
+            idle.push_back(rec);
+            return;
+        }
+    }
+    vosk_recognizer_free(rec);
+}
 
-    return transcript;
+size_t AsrVosk::recognizersCreated() const {
+    std::lock_guard<std::mutex> lk(poolMutex_);
+    return created_;
 }
 
-std::string AsrVosk::transcribe_and_get_full_json(const std::vector<int16_t>& pcm, double sampleRate) {
+AsrResult AsrVosk::recognize(const std::vector<int16_t>& pcm, double sampleRate) {
     if (!is_available_) {
         last_error_ = "Vosk model not available.";
-        return "{}";
+        return AsrResult();
     }
+    Recognizer recognizer = acquireRecognizer(VOSK_TARGET_SAMPLE_RATE);
+    if (!recognizer) {
+        last_error_ = "Failed to create Vosk recognizer.";
+        return AsrResult();
+    }
+    return recognize(recognizer, pcm, sampleRate);
+}
+
+AsrResult AsrVosk::recognize(const Recognizer& recognizer, const std::vector<int16_t>& pcm, double sampleRate) {
+    AsrResult result;
+    if (!recognizer) return result;
+    auto t0 = std::chrono::steady_clock::now();
 
     const std::vector<int16_t>* pcm_ptr = &pcm;
     std::vector<int16_t> resampled_pcm;
 
+    // Resample if the source sample rate doesn't match the target
     if (sampleRate != VOSK_TARGET_SAMPLE_RATE) {
-        resampled_pcm = resample(pcm, sampleRate, VOSK_TARGET_SAMPLE_RATE);
+        resampled_pcm = resamplePcm(pcm.data(), pcm.size(), sampleRate, VOSK_TARGET_SAMPLE_RATE);
         pcm_ptr = &resampled_pcm;
     }
 
-    VoskRecognizer* recognizer = vosk_recognizer_new(model_, (float)VOSK_TARGET_SAMPLE_RATE);
-    if (recognizer == nullptr) {
-        last_error_ = "Failed to create Vosk recognizer.";
-        return "{}";
+    // A single pass: if the buffer ends on an endpoint, Vosk moves the
+    // utterance to result() and final_result() only holds what follows.
+    if (vosk_recognizer_accept_waveform_s(recognizer.get(), pcm_ptr->data(), static_cast<int>(pcm_ptr->size())) == 1) {
+        result.append(vosk_recognizer_result(recognizer.get()));
     }
+    result.append(vosk_recognizer_final_result(recognizer.get()));
+    vosk_recognizer_reset(recognizer.get());
 
-    vosk_recognizer_accept_waveform_s(recognizer, pcm_ptr->data(), pcm_ptr->size());
-    const char* result_json = vosk_recognizer_final_result(recognizer);
-    std::string full_result = result_json;
-    vosk_recognizer_free(recognizer);
+    result.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
 
-    return full_result;
+std::string AsrVosk::transcribe(const std::vector<int16_t>& pcm, double sampleRate) {
+    return recognize(pcm, sampleRate).text;
+}
+
+std::string AsrVosk::transcribe_and_get_full_json(const std::vector<int16_t>& pcm, double sampleRate) {
+    return recognize(pcm, sampleRate).json;
 }
 
 #else
@@ -123,6 +170,12 @@ std::string AsrVosk::lastError() const {
     return last_error_;
 }
 
+AsrResult AsrVosk::recognize(const std::vector<int16_t>& pcm, double sampleRate) {
+    (void)pcm;
+    (void)sampleRate;
+    return AsrResult();
+}
+
 std::string AsrVosk::transcribe(const std::vector<int16_t>& pcm, double sampleRate) {
     (void)pcm; // Unused
     (void)sampleRate; // Unused
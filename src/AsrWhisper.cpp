@@ -0,0 +1,185 @@
+#include "AsrWhisper.h"
+#include "Resampler.h"
+#include "Vad.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <tuple>
+
+bool isWhisperEngine(const std::string& engine) {
+    return engine == "whisper" || engine == "whispercpp" || engine == "whisper.cpp";
+}
+
+#ifdef WITH_WHISPER
+#include <whisper.h>
+
+namespace {
+// Padding kept around the voiced span so word onsets and tails survive.
+constexpr double kTrimPadSeconds = 0.25;
+
+// [begin, end) of the samples between the first and last voiced 10 ms frame.
+std::pair<size_t, size_t> voicedSpan(const std::vector<int16_t>& pcm, double rate) {
+    const size_t frame = static_cast<size_t>(rate / 100);
+    Vad vad;
+    size_t first = pcm.size(), last = 0;
+    for (size_t pos = 0; pos + frame <= pcm.size(); pos += frame) {
+        vad.process(&pcm[pos], frame, rate);
+        if (vad.lastFrameIsSpeech()) {
+            first = std::min(first, pos);
+            last = pos + frame;
+        }
+    }
+    if (first >= last) return {0, 0};
+    const size_t pad = static_cast<size_t>(kTrimPadSeconds * rate);
+    return {first > pad ? first - pad : 0, std::min(pcm.size(), last + pad)};
+}
+}
+
+AsrWhisper::AsrWhisper(const WhisperConfig& cfg) : cfg_(cfg) {
+    if (cfg_.threads <= 0) {
+        cfg_.threads = static_cast<int>(std::min(8u, std::max(1u, std::thread::hardware_concurrency())));
+    }
+    // Whisper fails every decode on a code it does not know, such as the
+    // "C." a LANG of C.UTF-8 yields.
+    if (cfg_.language != "auto" && whisper_lang_id(cfg_.language.c_str()) < 0) {
+        std::cerr << "[asr-whisper] Unknown language \"" << cfg_.language << "\", detecting it instead." << std::endl;
+        cfg_.language = "auto";
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    whisper_context_params cparams = whisper_context_default_params();
+    cparams.use_gpu = cfg_.useGpu;
+    ctx_ = whisper_init_from_file_with_params(cfg_.modelPath.c_str(), cparams);
+    if (ctx_ == nullptr) {
+        lastError_ = "Failed to load whisper model from: " + cfg_.modelPath;
+        std::cerr << "[asr-whisper] " << lastError_ << std::endl;
+        return;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[asr-whisper] Loaded " << whisper_model_type_readable(ctx_) << " model in "
+              << static_cast<int>(ms) << " ms (" << cfg_.threads << " threads, "
+              << (cfg_.beamSize > 0 ? "beam " + std::to_string(cfg_.beamSize) : std::string("greedy")) << ")" << std::endl;
+}
+
+AsrWhisper::~AsrWhisper() {
+    if (ctx_ != nullptr) whisper_free(ctx_);
+}
+
+std::string AsrWhisper::lastError() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return lastError_;
+}
+
+AsrResult AsrWhisper::recognize(const std::vector<int16_t>& pcm, double sampleRate) {
+    AsrResult result;
+    if (ctx_ == nullptr) return result;
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<int16_t> resampled;
+    const std::vector<int16_t>* in = &pcm;
+    if (sampleRate != kSampleRate) {
+        resampled = resamplePcm(pcm.data(), pcm.size(), sampleRate, kSampleRate);
+        in = &resampled;
+    }
+
+    // Whisper pads every call to a 30 s window and tends to invent text on
+    // silence, so leading/trailing non-speech is not worth decoding.
+    size_t begin = 0, end = in->size();
+    if (cfg_.vadTrim) {
+        std::tie(begin, end) = voicedSpan(*in, kSampleRate);
+        if (begin >= end) {
+            result.rebuildJson();
+            return result;
+        }
+    }
+    std::vector<float> samples(end - begin);
+    for (size_t i = begin; i < end; ++i) samples[i - begin] = (*in)[i] / 32768.0f;
+    const double offset = begin / kSampleRate;
+
+    whisper_full_params params = whisper_full_default_params(
+        cfg_.beamSize > 0 ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY);
+    params.n_threads = cfg_.threads;
+    // "auto" detects the language and still transcribes; detect_language
+    // would stop whisper_full() right after detection.
+    params.language = cfg_.language.c_str();
+    params.translate = false;
+    params.no_context = true;
+    params.single_segment = false;
+    params.token_timestamps = true;
+    params.print_progress = false;
+    params.print_realtime = false;
+    params.print_timestamps = false;
+    params.print_special = false;
+    if (cfg_.beamSize > 0) params.beam_search.beam_size = cfg_.beamSize;
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (whisper_full(ctx_, params, samples.data(), static_cast<int>(samples.size())) != 0) {
+        lastError_ = "whisper_full failed.";
+        return result;
+    }
+
+    // Tokens starting with a space open a new word; timestamps are in 10 ms units.
+    const whisper_token eot = whisper_token_eot(ctx_);
+    AsrWord word;
+    int wordTokens = 0;
+    auto flush = [&]() {
+        if (wordTokens > 0 && !word.word.empty()) {
+            word.conf /= wordTokens;
+            result.words.push_back(word);
+        }
+        word = AsrWord();
+        wordTokens = 0;
+    };
+    const int segments = whisper_full_n_segments(ctx_);
+    for (int s = 0; s < segments; ++s) {
+        const int tokens = whisper_full_n_tokens(ctx_, s);
+        for (int t = 0; t < tokens; ++t) {
+            whisper_token_data data = whisper_full_get_token_data(ctx_, s, t);
+            if (data.id >= eot) continue;  // special and timestamp tokens
+            std::string piece = whisper_full_get_token_text(ctx_, s, t);
+            if (piece.empty()) continue;
+            if (piece[0] == ' ') {
+                flush();
+                piece.erase(0, 1);
+                word.start = offset + data.t0 / 100.0;
+            } else if (wordTokens == 0) {
+                word.start = offset + data.t0 / 100.0;
+            }
+            word.word += piece;
+            word.end = offset + data.t1 / 100.0;
+            word.conf += data.p;
+            ++wordTokens;
+        }
+    }
+    flush();
+
+    for (const auto& w : result.words) {
+        if (!result.text.empty()) result.text += ' ';
+        result.text += w.word;
+    }
+    result.rebuildJson();
+    result.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
+
+#else
+
+// --- Stub implementation when whisper.cpp is disabled ---
+
+AsrWhisper::AsrWhisper(const WhisperConfig& cfg) : cfg_(cfg) {
+    lastError_ = "whisper.cpp support is not enabled in this build (WITH_WHISPER=OFF).";
+}
+
+AsrWhisper::~AsrWhisper() {}
+
+std::string AsrWhisper::lastError() const {
+    return lastError_;
+}
+
+AsrResult AsrWhisper::recognize(const std::vector<int16_t>& pcm, double sampleRate) {
+    (void)pcm;
+    (void)sampleRate;
+    return AsrResult();
+}
+
+#endif // WITH_WHISPER
@@ -1,4 +1,5 @@
 #include "Audio.h"
+#include "AudioPlayer.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -6,6 +7,16 @@
 #include <cmath>
 #include <thread>
 #include <chrono>
+#include <limits>
+#include <fstream>
+#include <mutex>
+#if __has_include(<filesystem>)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
+#include "nlohmann/json.hpp"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -14,32 +25,6 @@
 #ifdef WITH_AUDIO
 // --- Private Helper Functions ---
 
-// Simple linear interpolation for resampling
-static std::vector<int16_t> resample(const std::vector<int16_t>& in, double in_rate, double out_rate) {
-    if (in_rate == out_rate) {
-        return in;
-    }
-    double ratio = in_rate / out_rate;
-    size_t out_len = static_cast<size_t>(in.size() / ratio);
-    std::vector<int16_t> out(out_len);
-
-    for (size_t i = 0; i < out_len; ++i) {
-        double in_idx_f = i * ratio;
-        size_t in_idx_i = static_cast<size_t>(in_idx_f);
-        double frac = in_idx_f - in_idx_i;
-
-        if (in_idx_i + 1 < in.size()) {
-            double v1 = in[in_idx_i];
-            double v2 = in[in_idx_i + 1];
-            out[i] = static_cast<int16_t>(v1 + (v2 - v1) * frac);
-        } else {
-            out[i] = in.back();
-        }
-    }
-    std::cout << "[audio] Resampled from " << in.size() << " samples to " << out.size() << " samples." << std::endl;
-    return out;
-}
-
 // Checks a list of standard sample rates for compatibility.
 std::vector<double> Audio::getSupportedSampleRates(const PaDeviceInfo* deviceInfo) {
     std::vector<double> supportedRates;
@@ -77,44 +62,145 @@ std::vector<double> Audio::getSupportedSampleRates(const PaDeviceInfo* deviceInf
 }
 
 
-double Audio::pickSupportedRate(PaDeviceIndex dev, bool isOutput, double preferredRate) {
+// --- Rate negotiation cache ---
+//
+// Pa_IsFormatSupported can take hundreds of milliseconds per call on ALSA and
+// Bluetooth devices. Results are kept per device (host API + name + channel
+// layout, since indexes change between runs) in a small JSON file and only
+// probed again for rates never seen before, or after forgetDevice().
+namespace {
+struct RateCache {
+    std::mutex mtx;
+    std::string path = "data/audio_devices.json";
+    bool loaded = false;
+    nlohmann::json j = nlohmann::json::object();
+};
+
+RateCache& rateCache() {
+    static RateCache cache;
+    return cache;
+}
+
+std::string deviceKey(const PaDeviceInfo* di) {
+    const PaHostApiInfo* api = Pa_GetHostApiInfo(di->hostApi);
+    return std::string(api && api->name ? api->name : "?") + "|" + (di->name ? di->name : "?") + "|"
+         + std::to_string(di->maxInputChannels) + "/" + std::to_string(di->maxOutputChannels);
+}
+
+std::string rateKey(double rate) {
+    return std::to_string(static_cast<long>(rate));
+}
+
+// Caller holds cache.mtx.
+void loadRateCache(RateCache& cache) {
+    if (cache.loaded) return;
+    cache.loaded = true;
+    std::ifstream f(cache.path);
+    if (!f) return;
+    try {
+        f >> cache.j;
+        if (!cache.j.is_object()) cache.j = nlohmann::json::object();
+    } catch (const nlohmann::json::parse_error&) {
+        cache.j = nlohmann::json::object();
+    }
+}
+
+// Caller holds cache.mtx.
+void saveRateCache(RateCache& cache) {
+    try {
+        std::filesystem::path p(cache.path);
+        if (p.has_parent_path()) std::filesystem::create_directories(p.parent_path());
+        std::string tmp = cache.path + ".tmp";
+        std::ofstream o(tmp);
+        if (!o) return;
+        o << cache.j.dump(2);
+        o.close();
+        std::filesystem::rename(tmp, cache.path);
+    } catch (const std::filesystem::filesystem_error&) {
+        // The cache is an optimisation only.
+    }
+}
+} // namespace
+
+void Audio::setRateCachePath(const std::string& path) {
+    RateCache& cache = rateCache();
+    std::lock_guard<std::mutex> lock(cache.mtx);
+    cache.path = path;
+    cache.loaded = false;
+    cache.j = nlohmann::json::object();
+}
+
+void Audio::forgetDevice(PaDeviceIndex dev) {
     const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
-    if (!di) return -1.0;
+    if (!di) return;
+    RateCache& cache = rateCache();
+    std::lock_guard<std::mutex> lock(cache.mtx);
+    loadRateCache(cache);
+    cache.j.erase(deviceKey(di));
+    saveRateCache(cache);
+}
 
-    // The requested list of rates to try
-    double cand[] = { preferredRate, 48000.0, 44100.0, 32000.0, 16000.0 };
+void Audio::clearRateCache() {
+    RateCache& cache = rateCache();
+    std::lock_guard<std::mutex> lock(cache.mtx);
+    cache.loaded = true;
+    cache.j = nlohmann::json::object();
+    saveRateCache(cache);
+}
+
+std::vector<double> Audio::probeRates(PaDeviceIndex dev, bool isOutput, const std::vector<double>& rates) {
+    std::vector<double> supported;
+    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
+    if (!di) return supported;
+    if ((isOutput ? di->maxOutputChannels : di->maxInputChannels) <= 0) return supported;
+
+    RateCache& cache = rateCache();
+    std::lock_guard<std::mutex> lock(cache.mtx);
+    loadRateCache(cache);
+    // A hand-edited or damaged file can hold anything: re-probe what is malformed.
+    nlohmann::json& device = cache.j[deviceKey(di)];
+    if (!device.is_object()) device = nlohmann::json::object();
+    nlohmann::json& entry = device[isOutput ? "out" : "in"];
+    if (!entry.is_object()) entry = nlohmann::json::object();
 
     PaStreamParameters streamParams{};
     streamParams.device = dev;
+    streamParams.channelCount = 1; // Mono
     streamParams.sampleFormat = paInt16;
     streamParams.suggestedLatency = isOutput ? di->defaultLowOutputLatency : di->defaultLowInputLatency;
     streamParams.hostApiSpecificStreamInfo = NULL;
 
-    PaStreamParameters* inP = nullptr;
-    PaStreamParameters* outP = nullptr;
-
-    if (isOutput) {
-        if (di->maxOutputChannels <= 0) return -1.0;
-        streamParams.channelCount = 1; // Mono
-        outP = &streamParams;
-    } else {
-        if (di->maxInputChannels <= 0) return -1.0;
-        streamParams.channelCount = 1; // Mono
-        inP = &streamParams;
-    }
-
-    for (double rate : cand) {
+    bool dirty = false;
+    for (double rate : rates) {
         if (rate <= 0) continue;
-        if (Pa_IsFormatSupported(inP, outP, rate) == paFormatIsSupported) {
-            std::cout << "[audio] Using sample rate: " << rate << " Hz\n";
-            return rate;
+        const std::string key = rateKey(rate);
+        if (!entry.contains(key) || !entry[key].is_boolean()) {
+            PaError err = isOutput ? Pa_IsFormatSupported(NULL, &streamParams, rate)
+                                   : Pa_IsFormatSupported(&streamParams, NULL, rate);
+            entry[key] = (err == paFormatIsSupported);
+            dirty = true;
+        }
+        if (entry[key].get<bool>()) {
+            supported.push_back(rate);
         }
     }
+    if (dirty) {
+        saveRateCache(cache);
+    }
+    return supported;
+}
+
+double Audio::pickSupportedRate(PaDeviceIndex dev, bool isOutput, double preferredRate) {
+    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
+    if (!di) return -1.0;
 
-    // As a last resort, try the device's default sample rate
-    if (di->defaultSampleRate > 0 && Pa_IsFormatSupported(inP, outP, di->defaultSampleRate) == paFormatIsSupported) {
-        std::cout << "[audio] Using device default sample rate: " << di->defaultSampleRate << " Hz\n";
-        return di->defaultSampleRate;
+    // The requested list of rates to try, device default as a last resort
+    const std::vector<double> cand = { preferredRate, 48000.0, 44100.0, 32000.0, 16000.0, di->defaultSampleRate };
+    std::vector<double> supported = probeRates(dev, isOutput, cand);
+    if (!supported.empty()) {
+        double rate = supported.front();
+        std::cout << "[audio] Using sample rate: " << rate << " Hz\n";
+        return rate;
     }
 
     std::cerr << "[audio] No supported sample rate found for device " << dev << ".\n";
@@ -161,7 +247,7 @@ std::vector<AudioDeviceInfo> Audio::listDevices() {
         return devices;
     }
 
-    double standardRates[] = { 48000.0, 44100.0, 32000.0, 16000.0, 8000.0 };
+    const std::vector<double> standardRates = { 48000.0, 44100.0, 32000.0, 16000.0, 8000.0 };
 
     for (int i = 0; i < numDevices; ++i) {
         const PaDeviceInfo* paInfo = Pa_GetDeviceInfo(i);
@@ -175,26 +261,9 @@ std::vector<AudioDeviceInfo> Audio::listDevices() {
             info.maxOutputChannels = paInfo->maxOutputChannels;
             info.defaultSampleRate = paInfo->defaultSampleRate;
 
-            // Check for supported sample rates
-            PaStreamParameters params;
-            params.device = i;
-            params.sampleFormat = paInt16;
-            params.suggestedLatency = 0;
-            params.hostApiSpecificStreamInfo = NULL;
-
-            for (double rate : standardRates) {
-                if (info.maxInputChannels > 0) {
-                    params.channelCount = 1;
-                    if (Pa_IsFormatSupported(&params, NULL, rate) == paFormatIsSupported) {
-                        info.supportedSampleRates.push_back(rate);
-                    }
-                } else if (info.maxOutputChannels > 0) {
-                    params.channelCount = 1;
-                     if (Pa_IsFormatSupported(NULL, &params, rate) == paFormatIsSupported) {
-                        info.supportedSampleRates.push_back(rate);
-                    }
-                }
-            }
+            // Check for supported sample rates (answered from the cache after the first run)
+            for (double rate : probeRates(i, false, standardRates)) info.supportedSampleRates.push_back(rate);
+            for (double rate : probeRates(i, true, standardRates)) info.supportedSampleRates.push_back(rate);
             // Remove duplicates (e.g. if both in/out support it)
             std::sort(info.supportedSampleRates.begin(), info.supportedSampleRates.end());
             info.supportedSampleRates.erase(std::unique(info.supportedSampleRates.begin(), info.supportedSampleRates.end()), info.supportedSampleRates.end());
@@ -279,6 +348,7 @@ bool Audio::record(int deviceId, int seconds, double& sampleRate, std::vector<in
     PaError err = Pa_OpenStream(&stream, &inParams, nullptr, sampleRate, paFramesPerBufferUnspecified, paNoFlag, nullptr, nullptr);
     if (err != paNoError || !stream) {
         std::cerr << "[audio] PortAudio error (Pa_OpenStream, record): " << Pa_GetErrorText(err) << "\n";
+        forgetDevice(dev); // stale cached answer; probe again next time
         return false;
     }
 
@@ -300,55 +370,45 @@ bool Audio::record(int deviceId, int seconds, double& sampleRate, std::vector<in
     return err == paNoError || err == paInputOverflowed;
 }
 
-bool Audio::recordPtt(int deviceId, int maxSeconds, double& sampleRate, std::vector<int16_t>& buffer) {
-    PaDeviceIndex dev = (deviceId >= 0) ? deviceId : Pa_GetDefaultInputDevice();
-    if (dev == paNoDevice) {
-        std::cerr << "[audio] No input device found.\n";
+bool Audio::recordFrames(int deviceId, int maxSeconds, double& sampleRate, int frameMs,
+                         const FrameSink& sink, CaptureStats* stats) {
+    AudioCapture capture;
+    // Size the ring for a few seconds of slack; the consumer drains it every frame.
+    if (!capture.open(deviceId, sampleRate, 4.0)) {
         return false;
     }
+    bool ok = recordFrames(capture, maxSeconds, frameMs, sink, stats);
+    capture.close();
+    return ok;
+}
 
-    sampleRate = pickSupportedRate(dev, false, sampleRate);
-    if (sampleRate <= 0) {
-        std::cerr << "[audio] Could not find a supported sample rate for recording.\n";
-        return false;
-    }
-
-    buffer.clear();
-    // Reserve for ~10s of audio data as requested
-    buffer.reserve(static_cast<size_t>(10 * sampleRate));
-
-    PaStream* stream = nullptr;
-    PaStreamParameters inParams{};
-    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
-    inParams.device = dev;
-    inParams.channelCount = 1;
-    inParams.sampleFormat = paInt16;
-    inParams.suggestedLatency = di ? di->defaultLowInputLatency : 0.050;
-
-    PaError err = Pa_OpenStream(&stream, &inParams, nullptr, sampleRate, paFramesPerBufferUnspecified, paNoFlag, nullptr, nullptr);
-    if (err != paNoError || !stream) {
-        std::cerr << "[audio] PortAudio error (Pa_OpenStream, recordPtt): " << Pa_GetErrorText(err) << "\n";
+bool Audio::recordFrames(AudioCapture& capture, int maxSeconds, int frameMs,
+                         const FrameSink& sink, CaptureStats* stats) {
+    if (!capture.isOpen()) {
         return false;
     }
-
-    if ((err = Pa_StartStream(stream)) != paNoError) {
-        std::cerr << "[audio] PortAudio error (Pa_StartStream, recordPtt): " << Pa_GetErrorText(err) << "\n";
-        Pa_CloseStream(stream);
-        return false;
-    }
-
-    auto startTime = std::chrono::steady_clock::now();
+    const double sampleRate = capture.sampleRate();
+    const size_t frameSamples = std::max<size_t>(1, static_cast<size_t>(sampleRate * frameMs / 1000.0));
+    std::vector<int16_t> frame(frameSamples);
+    const size_t maxSamples = static_cast<size_t>(maxSeconds * sampleRate);
+    size_t total = 0;
 
     // Clear any pending newline from previous input
     while (std::cin.rdbuf()->in_avail() > 0) {
         std::cin.get();
     }
 
-    while (true) {
+    // Arming hands over the pre-roll window first when the stream was idle.
+    capture.resetStats();
+    capture.arm();
+    if (!capture.start()) {
+        return false;
+    }
+
+    bool keepGoing = true;
+    while (keepGoing) {
         // Check for stop condition: time limit
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - startTime).count();
-        if (elapsed >= maxSeconds) {
+        if (total >= maxSamples) {
             std::cout << "[audio] Reached max recording time of " << maxSeconds << "s.\n";
             break;
         }
@@ -361,103 +421,83 @@ bool Audio::recordPtt(int deviceId, int maxSeconds, double& sampleRate, std::vec
             break;
         }
 
-        // Read available audio data
-        long framesAvailable = Pa_GetStreamReadAvailable(stream);
-        if (framesAvailable > 0) {
-            size_t oldSize = buffer.size();
-            buffer.resize(oldSize + framesAvailable);
-            err = Pa_ReadStream(stream, buffer.data() + oldSize, (unsigned long)framesAvailable);
-            if (err != paNoError && err != paInputOverflowed) {
-                std::cerr << "[audio] PortAudio error (Pa_ReadStream): " << Pa_GetErrorText(err) << "\n";
-            }
+        // Wait at most one frame so the stop checks above stay responsive.
+        if (capture.waitFrame(frame.data(), frameSamples, frameMs)) {
+            total += frameSamples;
+            keepGoing = sink(frame.data(), frameSamples);
         }
+    }
 
-        // Don't busy-wait
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    if (keepGoing) {
+        // Hand over the tail that did not fill a whole frame.
+        size_t rest = capture.read(frame.data(), frameSamples);
+        if (rest > 0) {
+            total += rest;
+            sink(frame.data(), rest);
+        }
     }
+    // Back to pre-roll only; the stream itself stays open for the next turn.
+    capture.disarm();
 
-    Pa_StopStream(stream);
-    Pa_CloseStream(stream);
-    std::cout << "[audio] Recording finished. Total duration: " << (double)buffer.size() / sampleRate << "s\n";
+    CaptureStats s = capture.stats();
+    if (s.overruns > 0 || s.deviceOverflows > 0) {
+        std::cerr << "[audio] Capture overruns: " << s.overruns << " (" << s.samplesDropped
+                  << " samples dropped), device overflows: " << s.deviceOverflows << "\n";
+    }
+    if (stats) *stats = s;
     return true;
 }
 
+bool Audio::recordPtt(int deviceId, int maxSeconds, double& sampleRate, std::vector<int16_t>& buffer) {
+    buffer.clear();
 
-bool Audio::playback(int deviceId, double sampleRate, const std::vector<int16_t>& buffer) {
-    if (buffer.empty()) {
-        std::cerr << "[audio] Playback buffer is empty.\n";
-        return false;
-    }
+    // Reserve the whole capture up front so that appending never reallocates.
+    double reserveRate = sampleRate > 0 ? std::max(sampleRate, 48000.0) : 48000.0;
+    buffer.reserve(static_cast<size_t>(maxSeconds * reserveRate) + 1);
 
-    PaDeviceIndex dev = (deviceId >= 0) ? deviceId : Pa_GetDefaultOutputDevice();
-    if (dev == paNoDevice) {
-        std::cerr << "[audio] No output device found.\n";
+    bool ok = recordFrames(deviceId, maxSeconds, sampleRate, 10,
+        [&buffer](const int16_t* frame, size_t samples) {
+            buffer.insert(buffer.end(), frame, frame + samples);
+            return true;
+        });
+    if (!ok) {
         return false;
     }
 
-    // Find the best rate, preferring the native TTS rate
-    const double ratesToTry[] = { sampleRate, 48000.0, 44100.0, 32000.0, 16000.0 };
-    double actualRate = -1.0;
-    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
-    PaStreamParameters outParams{};
-    outParams.device = dev;
-    outParams.channelCount = 1;
-    outParams.sampleFormat = paInt16;
-    outParams.suggestedLatency = di ? di->defaultLowOutputLatency : 0.050;
+    std::cout << "[audio] Recording finished. Total duration: " << (double)buffer.size() / sampleRate << "s\n";
+    return true;
+}
 
-    for (double rate : ratesToTry) {
-        if (rate > 0 && Pa_IsFormatSupported(NULL, &outParams, rate) == paFormatIsSupported) {
-            actualRate = rate;
-            break;
-        }
-    }
 
-    if (actualRate <= 0) {
-        std::cerr << "[audio] Could not find any supported sample rate for playback on device " << dev << ".\n";
+bool Audio::playback(int deviceId, double sampleRate, const std::vector<int16_t>& buffer) {
+    if (buffer.empty()) {
+        std::cerr << "[audio] Playback buffer is empty.\n";
         return false;
     }
 
-    // Log TTS and effective rates
-    std::cout << "[audio] TTS sample rate: " << sampleRate << " Hz\n";
-    std::cout << "[audio] Effective playback rate: " << actualRate << " Hz\n";
-
-    // Resample if necessary
-    std::vector<int16_t> resampled_buffer;
-    const std::vector<int16_t>* buffer_to_play = &buffer;
-
-    if (actualRate != sampleRate) {
-        std::cout << "[audio] Resampling: yes\n";
-        resampled_buffer = resample(buffer, sampleRate, actualRate);
-        buffer_to_play = &resampled_buffer;
-    } else {
-        std::cout << "[audio] Resampling: no\n";
-    }
-
-    PaStream* stream = nullptr;
-    PaError err = Pa_OpenStream(&stream, nullptr, &outParams, actualRate, paFramesPerBufferUnspecified, paNoFlag, nullptr, nullptr);
-    if (err != paNoError || !stream) {
-        std::cerr << "[audio] PortAudio error (Pa_OpenStream, playback): " << Pa_GetErrorText(err) << "\n";
+    // One-shot wrapper around the streaming engine: prefer the native TTS rate.
+    AudioPlayer player;
+    if (!player.open(deviceId, sampleRate, buffer.size() / sampleRate + 1.0)) {
         return false;
     }
 
-    if ((err = Pa_StartStream(stream)) != paNoError) {
-        std::cerr << "[audio] PortAudio error (Pa_StartStream, playback): " << Pa_GetErrorText(err) << "\n";
-        Pa_CloseStream(stream);
-        return false;
-    }
+    // Log TTS and effective rates
+    std::cout << "[audio] TTS sample rate: " << sampleRate << " Hz\n";
+    std::cout << "[audio] Effective playback rate: " << player.sampleRate() << " Hz\n";
+    std::cout << "[audio] Resampling: " << (player.sampleRate() != sampleRate ? "yes" : "no") << "\n";
 
     std::cout << "[audio] Playing back audio...\n";
-    err = Pa_WriteStream(stream, buffer_to_play->data(), (unsigned long)buffer_to_play->size());
-    if (err != paNoError && err != paOutputUnderflowed) {
-        std::cerr << "[audio] PortAudio error (Pa_WriteStream): " << Pa_GetErrorText(err) << "\n";
+    bool ok = player.enqueue(buffer, sampleRate);
+    if (ok) {
+        player.waitIdle();
     }
-
-    Pa_Sleep((long)(buffer_to_play->size() * 1000 / actualRate));
-
-    Pa_StopStream(stream);
-    Pa_CloseStream(stream);
+    PlaybackStats s = player.stats();
+    if (s.underruns > 0) {
+        std::cerr << "[audio] Playback underruns: " << s.underruns << "\n";
+    }
+    player.close();
     std::cout << "[audio] Playback finished.\n";
-    return err == paNoError || err == paOutputUnderflowed;
+    return ok;
 }
 
 #endif // WITH_AUDIO
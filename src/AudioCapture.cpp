@@ -0,0 +1,220 @@
+#include "AudioCapture.h"
+#include "Audio.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#ifdef WITH_AUDIO
+
+AudioCapture::AudioCapture() {}
+
+AudioCapture::~AudioCapture() {
+    close();
+}
+
+int AudioCapture::paCallback(const void* input, void* output, unsigned long frameCount,
+                             const PaStreamCallbackTimeInfo* timeInfo,
+                             PaStreamCallbackFlags statusFlags, void* userData) {
+    (void)output;
+    (void)timeInfo;
+    auto* self = static_cast<AudioCapture*>(userData);
+    if (statusFlags & paInputOverflow) {
+        self->deviceOverflows_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (input == nullptr) {
+        return paContinue;
+    }
+    const auto* in = static_cast<const int16_t*>(input);
+
+    int mode = self->mode_.load(std::memory_order_acquire);
+    if (mode == kDisarmRequested) {
+        mode = kIdle;
+        self->mode_.store(kIdle, std::memory_order_release);
+    } else if (mode == kArmRequested) {
+        self->flushPreRoll();
+        mode = kArmed;
+        self->mode_.store(kArmed, std::memory_order_release);
+    }
+    if (mode == kIdle) {
+        self->pushPreRoll(in, frameCount);
+        return paContinue;
+    }
+
+    size_t written = self->ring_.write(in, frameCount);
+    self->samplesCaptured_.fetch_add(frameCount, std::memory_order_relaxed);
+    if (written < frameCount) {
+        self->samplesDropped_.fetch_add(frameCount - written, std::memory_order_relaxed);
+        self->overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return paContinue;
+}
+
+void AudioCapture::pushPreRoll(const int16_t* in, size_t n) {
+    const size_t cap = preRoll_.size();
+    if (cap == 0) return;
+    if (n >= cap) {
+        std::memcpy(preRoll_.data(), in + (n - cap), cap * sizeof(int16_t));
+        preRollPos_ = 0;
+        preRollFill_ = cap;
+        return;
+    }
+    size_t first = std::min(n, cap - preRollPos_);
+    std::memcpy(&preRoll_[preRollPos_], in, first * sizeof(int16_t));
+    if (n > first) std::memcpy(&preRoll_[0], in + first, (n - first) * sizeof(int16_t));
+    preRollPos_ = (preRollPos_ + n) % cap;
+    preRollFill_ = std::min(cap, preRollFill_ + n);
+}
+
+void AudioCapture::flushPreRoll() {
+    const size_t cap = preRoll_.size();
+    if (cap == 0 || preRollFill_ == 0) return;
+    // Oldest sample first.
+    size_t start = (preRollPos_ + cap - preRollFill_) % cap;
+    size_t first = std::min(preRollFill_, cap - start);
+    size_t written = ring_.write(&preRoll_[start], first);
+    if (preRollFill_ > first) written += ring_.write(&preRoll_[0], preRollFill_ - first);
+    if (written < preRollFill_) {
+        samplesDropped_.fetch_add(preRollFill_ - written, std::memory_order_relaxed);
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    preRollFill_ = 0;
+}
+
+bool AudioCapture::open(int deviceId, double& sampleRate, double ringSeconds) {
+    close();
+
+    PaDeviceIndex dev = (deviceId >= 0) ? deviceId : Pa_GetDefaultInputDevice();
+    if (dev == paNoDevice) {
+        std::cerr << "[audio] No input device found.\n";
+        return false;
+    }
+
+    sampleRate = Audio::pickSupportedRate(dev, false, sampleRate);
+    if (sampleRate <= 0) {
+        std::cerr << "[audio] Could not find a supported sample rate for recording.\n";
+        return false;
+    }
+    sampleRate_ = sampleRate;
+
+    // The ring is sized once here; the callback never allocates.
+    ring_.reset(static_cast<size_t>(std::max(0.5, ringSeconds) * sampleRate));
+    preRoll_.assign(static_cast<size_t>(std::max(0, preRollMs_) * sampleRate / 1000.0), 0);
+    preRollPos_ = 0;
+    preRollFill_ = 0;
+    mode_ = kArmed;
+    resetStats();
+
+    PaStreamParameters inParams{};
+    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
+    inParams.device = dev;
+    inParams.channelCount = 1;
+    inParams.sampleFormat = paInt16;
+    inParams.suggestedLatency = di ? di->defaultLowInputLatency : 0.050;
+    inParams.hostApiSpecificStreamInfo = nullptr;
+
+    PaError err = Pa_OpenStream(&stream_, &inParams, nullptr, sampleRate, paFramesPerBufferUnspecified,
+                                paClipOff, &AudioCapture::paCallback, this);
+    if (err != paNoError || !stream_) {
+        std::cerr << "[audio] PortAudio error (Pa_OpenStream, capture): " << Pa_GetErrorText(err) << "\n";
+        Audio::forgetDevice(dev); // stale cached answer; probe again next time
+        stream_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool AudioCapture::start() {
+    if (!stream_) return false;
+    if (running_) return true;
+    PaError err = Pa_StartStream(stream_);
+    if (err != paNoError) {
+        std::cerr << "[audio] PortAudio error (Pa_StartStream, capture): " << Pa_GetErrorText(err) << "\n";
+        return false;
+    }
+    running_ = true;
+    return true;
+}
+
+void AudioCapture::stop() {
+    if (stream_ && running_) {
+        Pa_StopStream(stream_);
+    }
+    running_ = false;
+}
+
+void AudioCapture::close() {
+    stop();
+    if (stream_) {
+        Pa_CloseStream(stream_);
+        stream_ = nullptr;
+    }
+}
+
+void AudioCapture::waitForMode(int mode) {
+    // The callback acknowledges within one device buffer.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+    while (mode_.load(std::memory_order_acquire) != mode && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void AudioCapture::arm() {
+    int mode = mode_.load();
+    if (mode == kArmed || mode == kArmRequested) return;
+    mode_.store(kArmRequested, std::memory_order_release);
+    if (running_) waitForMode(kArmed);
+}
+
+void AudioCapture::disarm() {
+    int mode = mode_.load();
+    if (mode == kIdle || mode == kDisarmRequested) return;
+    if (!running_) {
+        mode_.store(kIdle, std::memory_order_release);
+    } else {
+        mode_.store(kDisarmRequested, std::memory_order_release);
+        waitForMode(kIdle);
+    }
+    ring_.clear();
+}
+
+bool AudioCapture::readFrame(int16_t* dst, size_t n) {
+    if (ring_.readAvailable() < n) return false;
+    return ring_.read(dst, n) == n;
+}
+
+bool AudioCapture::waitFrame(int16_t* dst, size_t n, int timeoutMs) {
+    if (readFrame(dst, n)) return true;
+    if (!running_ || sampleRate_ <= 0) return false;
+
+    // Sleep roughly until the missing samples should have arrived, in short
+    // slices so that the caller keeps a low stop latency.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        size_t have = ring_.readAvailable();
+        if (have >= n) return readFrame(dst, n);
+        double missingMs = (n - have) * 1000.0 / sampleRate_;
+        int sliceMs = std::max(1, std::min(10, static_cast<int>(missingMs)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(sliceMs));
+    }
+    return readFrame(dst, n);
+}
+
+CaptureStats AudioCapture::stats() const {
+    CaptureStats s;
+    s.samplesCaptured = samplesCaptured_.load(std::memory_order_relaxed);
+    s.samplesDropped = samplesDropped_.load(std::memory_order_relaxed);
+    s.overruns = overruns_.load(std::memory_order_relaxed);
+    s.deviceOverflows = deviceOverflows_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void AudioCapture::resetStats() {
+    samplesCaptured_ = 0;
+    samplesDropped_ = 0;
+    overruns_ = 0;
+    deviceOverflows_ = 0;
+}
+
+#endif // WITH_AUDIO
@@ -0,0 +1,313 @@
+#include "AudioConditioner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+bool parseConditionerStages(const std::string& list, ConditionerConfig& cfg) {
+    ConditionerConfig parsed = cfg;
+    parsed.highPass = parsed.noiseSuppression = parsed.agc = false;
+    std::stringstream ss(list);
+    std::string stage;
+    while (std::getline(ss, stage, ',')) {
+        if (stage == "hpf") parsed.highPass = true;
+        else if (stage == "ns") parsed.noiseSuppression = true;
+        else if (stage == "agc") parsed.agc = true;
+        else if (stage == "none" || stage.empty()) continue;
+        else return false;
+    }
+    cfg = parsed;
+    return true;
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// In-place iterative radix-2 FFT. Complex products are written out by hand:
+// std::complex<float> operator* carries NaN/Inf recovery code that keeps the
+// butterflies from being vectorised.
+void fft(std::complex<float>* a, size_t n, const std::vector<uint32_t>& rev,
+         const std::vector<std::complex<float>>& tw) {
+    for (size_t i = 0; i < n; ++i) {
+        if (i < rev[i]) std::swap(a[i], a[rev[i]]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t half = len / 2, step = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t j = 0; j < half; ++j) {
+                const std::complex<float> w = tw[j * step];
+                const std::complex<float> u = a[i + j];
+                const std::complex<float> x = a[i + j + half];
+                const std::complex<float> v(x.real() * w.real() - x.imag() * w.imag(),
+                                            x.real() * w.imag() + x.imag() * w.real());
+                a[i + j] = u + v;
+                a[i + j + half] = u - v;
+            }
+        }
+    }
+}
+} // namespace
+
+AudioConditioner::AudioConditioner(const ConditionerConfig& cfg) : cfg_(cfg) {}
+
+void AudioConditioner::configure(double sampleRate) {
+    rate_ = sampleRate;
+
+    // RBJ high-pass biquad, Butterworth Q.
+    const double w0 = 2.0 * M_PI * std::min(cfg_.highPassHz, 0.45 * sampleRate) / sampleRate;
+    const double alpha = std::sin(w0) / (2.0 * std::sqrt(0.5));
+    const double c = std::cos(w0);
+    const double a0 = 1.0 + alpha;
+    b0_ = static_cast<float>((1.0 + c) / 2.0 / a0);
+    b1_ = static_cast<float>(-(1.0 + c) / a0);
+    b2_ = b0_;
+    a1_ = static_cast<float>(-2.0 * c / a0);
+    a2_ = static_cast<float>((1.0 - alpha) / a0);
+
+    // ~16 ms frames or the next power of two: 256 at 16 kHz, 1024 at 48 kHz.
+    fftSize_ = 256;
+    while (fftSize_ < sampleRate * 0.016) fftSize_ *= 2;
+    hop_ = fftSize_ / 2;
+    window_.resize(fftSize_);
+    for (size_t i = 0; i < fftSize_; ++i) {
+        window_[i] = static_cast<float>(std::sqrt(0.5 - 0.5 * std::cos(2.0 * M_PI * i / fftSize_)));
+    }
+    twiddles_.resize(fftSize_ / 2);
+    for (size_t k = 0; k < twiddles_.size(); ++k) {
+        twiddles_[k] = std::polar(1.0f, static_cast<float>(-2.0 * M_PI * k / fftSize_));
+    }
+    bitrev_.resize(fftSize_);
+    size_t bits = 0;
+    while ((size_t(1) << bits) < fftSize_) ++bits;
+    for (size_t i = 0; i < fftSize_; ++i) {
+        uint32_t r = 0;
+        for (size_t b = 0; b < bits; ++b) r |= ((i >> b) & 1u) << (bits - 1 - b);
+        bitrev_[i] = r;
+    }
+    spec_.resize(fftSize_);
+    const size_t bins = fftSize_ / 2 + 1;
+    power_.resize(bins);
+    noisePsd_.resize(bins);
+    gain_.resize(bins);
+    prevPost_.resize(bins);
+
+    agcBlock_ = std::max<size_t>(1, static_cast<size_t>(sampleRate / 100.0));
+    reset();
+}
+
+void AudioConditioner::reset() {
+    z1_ = z2_ = 0.0f;
+    frameIn_.assign(fftSize_, 0.0f);
+    ola_.assign(fftSize_, 0.0f);
+    frameFill_ = 0;
+    std::fill(noisePsd_.begin(), noisePsd_.end(), 0.0f);
+    std::fill(gain_.begin(), gain_.end(), 1.0f);
+    std::fill(prevPost_.begin(), prevPost_.end(), 1.0f);
+    nsFrames_ = 0;
+    nsIn_ = nsOut_ = 0;
+    // The first frame ends hop_ samples into the stream; what it emits
+    // before time zero is padding.
+    nsSkip_ = fftSize_ - hop_;
+    agcGainDb_ = agcFromDb_ = 0.0;
+    agcEnergy_ = 0.0;
+    agcFill_ = 0;
+}
+
+size_t AudioConditioner::latencySamples() const {
+    return cfg_.noiseSuppression ? fftSize_ - hop_ : 0;
+}
+
+void AudioConditioner::highPass(float* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const float in = x[i];
+        const float y = b0_ * in + z1_;
+        z1_ = b1_ * in - a1_ * y + z2_;
+        z2_ = b2_ * in - a2_ * y;
+        x[i] = y;
+    }
+}
+
+void AudioConditioner::noiseFrame() {
+    const size_t n = fftSize_;
+    const size_t bins = n / 2 + 1;
+    for (size_t i = 0; i < n; ++i) spec_[i] = std::complex<float>(frameIn_[i] * window_[i], 0.0f);
+    fft(spec_.data(), n, bitrev_, twiddles_);
+
+    for (size_t k = 0; k < bins; ++k) {
+        power_[k] = spec_[k].real() * spec_[k].real() + spec_[k].imag() * spec_[k].imag();
+    }
+
+    // Noise PSD: averaged over the first frames (pre-roll, lead-in silence),
+    // then a running mean of the bins that look like noise; bins well above
+    // it (speech) only let it creep upwards.
+    if (nsFrames_ < 8) {
+        const float w = 1.0f / static_cast<float>(nsFrames_ + 1);
+        for (size_t k = 0; k < bins; ++k) noisePsd_[k] += (power_[k] - noisePsd_[k]) * w;
+    } else {
+        for (size_t k = 0; k < bins; ++k) {
+            const float p = power_[k], nz = noisePsd_[k];
+            noisePsd_[k] = (p < 4.0f * nz) ? 0.95f * nz + 0.05f * p : nz * 1.002f;
+        }
+    }
+    ++nsFrames_;
+
+    // Decision-directed Wiener gain, floored at maxReductionDb.
+    const float floorGain = static_cast<float>(std::pow(10.0, -cfg_.maxReductionDb / 20.0));
+    for (size_t k = 0; k < bins; ++k) {
+        const float post = power_[k] / std::max(noisePsd_[k], 1e-3f);
+        const float prio = 0.98f * gain_[k] * gain_[k] * prevPost_[k] + 0.02f * std::max(post - 1.0f, 0.0f);
+        gain_[k] = std::max(prio / (1.0f + prio), floorGain);
+        prevPost_[k] = post;
+    }
+
+    for (size_t k = 0; k < bins; ++k) spec_[k] *= gain_[k];
+    for (size_t k = 1; k < n / 2; ++k) spec_[n - k] = std::conj(spec_[k]);
+
+    // Inverse FFT via conjugation; synthesis window; overlap-add.
+    for (size_t i = 0; i < n; ++i) spec_[i] = std::conj(spec_[i]);
+    fft(spec_.data(), n, bitrev_, twiddles_);
+    const float scale = 1.0f / static_cast<float>(n);
+    for (size_t i = 0; i < n; ++i) ola_[i] += spec_[i].real() * scale * window_[i];
+}
+
+void AudioConditioner::noiseSuppress(const float* in, size_t n, std::vector<float>& out) {
+    size_t pos = 0;
+    while (pos < n) {
+        const size_t take = std::min(n - pos, hop_ - frameFill_);
+        std::copy(in + pos, in + pos + take, frameIn_.begin() + (fftSize_ - hop_ + frameFill_));
+        frameFill_ += take;
+        pos += take;
+        if (frameFill_ < hop_) break;
+
+        noiseFrame();
+        // The first hop_ samples of the accumulator are complete.
+        size_t from = std::min(nsSkip_, hop_);
+        nsSkip_ -= from;
+        size_t count = hop_ - from;
+        count = static_cast<size_t>(std::min<uint64_t>(count, nsIn_ - nsOut_));
+        out.insert(out.end(), ola_.begin() + from, ola_.begin() + from + count);
+        nsOut_ += count;
+
+        std::copy(ola_.begin() + hop_, ola_.end(), ola_.begin());
+        std::fill(ola_.end() - hop_, ola_.end(), 0.0f);
+        std::copy(frameIn_.begin() + hop_, frameIn_.end(), frameIn_.begin());
+        frameFill_ = 0;
+    }
+}
+
+// The gain measured on one block is ramped in across the next, so every
+// sample's gain depends only on complete blocks and chunking has no effect.
+void AudioConditioner::applyAgc(float* x, size_t n) {
+    for (size_t pos = 0; pos < n;) {
+        const size_t len = std::min(agcBlock_ - agcFill_, n - pos);
+        float* seg = x + pos;
+
+        // Ramp across the block so gain steps do not click.
+        const float g0 = static_cast<float>(std::pow(10.0, agcFromDb_ / 20.0));
+        const float g1 = static_cast<float>(std::pow(10.0, agcGainDb_ / 20.0));
+        const float dg = (g1 - g0) / static_cast<float>(agcBlock_);
+        for (size_t i = 0; i < len; ++i) {
+            agcEnergy_ += seg[i] * seg[i];
+            seg[i] *= g0 + dg * static_cast<float>(agcFill_ + i);
+        }
+        agcFill_ += len;
+        pos += len;
+        if (agcFill_ < agcBlock_) break;
+
+        const double levelDb = 10.0 * std::log10(agcEnergy_ / agcBlock_ / (32768.0 * 32768.0) + 1e-12);
+        agcFromDb_ = agcGainDb_;
+        if (levelDb > cfg_.agcGateDb) {
+            const double wantDb = std::min(cfg_.agcMaxGainDb, cfg_.agcTargetDb - levelDb);
+            if (wantDb < agcGainDb_) {
+                agcGainDb_ += (wantDb - agcGainDb_) * 0.5;                          // fast attack
+            } else {
+                agcGainDb_ = std::min(wantDb, agcGainDb_ + 10.0 * agcBlock_ / rate_);  // 10 dB/s release
+            }
+        }
+        agcEnergy_ = 0.0;
+        agcFill_ = 0;
+    }
+}
+
+void AudioConditioner::emit(const float* x, size_t n, std::vector<int16_t>& out) {
+    const size_t start = out.size();
+    out.resize(start + n);
+    for (size_t i = 0; i < n; ++i) {
+        const float v = std::max(-32768.0f, std::min(32767.0f, x[i]));
+        out[start + i] = static_cast<int16_t>(std::lrint(v));
+    }
+}
+
+void AudioConditioner::process(const int16_t* in, size_t samples, double sampleRate, std::vector<int16_t>& out) {
+    if (sampleRate != rate_) configure(sampleRate);
+    if (!cfg_.anyEnabled()) {
+        out.insert(out.end(), in, in + samples);
+        return;
+    }
+
+    scratch_.resize(samples);
+    for (size_t i = 0; i < samples; ++i) scratch_[i] = in[i];
+    float* data = scratch_.data();
+    size_t n = samples;
+
+    if (cfg_.highPass) {
+        auto t0 = Clock::now();
+        highPass(scratch_.data(), n);
+        stats_.highPass.cpuSeconds += secondsSince(t0);
+        stats_.highPass.samples += n;
+    }
+    if (cfg_.noiseSuppression) {
+        auto t0 = Clock::now();
+        nsOutBuf_.clear();
+        nsIn_ += n;
+        noiseSuppress(data, n, nsOutBuf_);
+        stats_.noise.cpuSeconds += secondsSince(t0);
+        stats_.noise.samples += n;
+        data = nsOutBuf_.data();
+        n = nsOutBuf_.size();
+    }
+    if (cfg_.agc && n > 0) {
+        auto t0 = Clock::now();
+        applyAgc(data, n);
+        stats_.agc.cpuSeconds += secondsSince(t0);
+        stats_.agc.samples += n;
+    }
+    emit(data, n, out);
+}
+
+void AudioConditioner::flush(std::vector<int16_t>& out) {
+    if (rate_ > 0 && cfg_.noiseSuppression && nsOut_ < nsIn_) {
+        // Push silence through until every real sample has come out.
+        const std::vector<float> zeros(fftSize_, 0.0f);
+        nsOutBuf_.clear();
+        while (nsOut_ < nsIn_) noiseSuppress(zeros.data(), zeros.size(), nsOutBuf_);
+        if (cfg_.agc && !nsOutBuf_.empty()) applyAgc(nsOutBuf_.data(), nsOutBuf_.size());
+        emit(nsOutBuf_.data(), nsOutBuf_.size(), out);
+    }
+    if (rate_ > 0) reset();
+}
+
+std::vector<int16_t> AudioConditioner::processBuffer(const std::vector<int16_t>& pcm, double sampleRate) {
+    std::vector<int16_t> out;
+    out.reserve(pcm.size());
+    reset();
+    process(pcm.data(), pcm.size(), sampleRate, out);
+    flush(out);
+    return out;
+}
+
+std::string AudioConditioner::statsLine() const {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "[cond] hpf %.1f us, ns %.1f us, agc %.1f us per 10 ms frame",
+                  stats_.highPass.usPer10ms(rate_), stats_.noise.usPer10ms(rate_), stats_.agc.usPer10ms(rate_));
+    return buf;
+}
@@ -0,0 +1,191 @@
+#include "AudioPlayer.h"
+#include "Audio.h"
+#include "Resampler.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#ifdef WITH_AUDIO
+
+AudioPlayer::AudioPlayer() {}
+
+AudioPlayer::~AudioPlayer() {
+    close();
+}
+
+int AudioPlayer::paCallback(const void* input, void* output, unsigned long frameCount,
+                            const PaStreamCallbackTimeInfo* timeInfo,
+                            PaStreamCallbackFlags statusFlags, void* userData) {
+    (void)input;
+    (void)timeInfo;
+    (void)statusFlags;
+    auto* self = static_cast<AudioPlayer*>(userData);
+    auto* out = static_cast<int16_t*>(output);
+
+    // The callback is the ring's only consumer, so it is the one to drop
+    // queued audio when a flush has been requested.
+    if (self->flushRequested_.load(std::memory_order_acquire)) {
+        size_t dropped = self->ring_.readAvailable();
+        self->ring_.skip(dropped);
+        self->samplesFlushed_.fetch_add(dropped, std::memory_order_relaxed);
+        self->flushRequested_.store(false, std::memory_order_release);
+    }
+
+    size_t got = self->ring_.read(out, frameCount);
+    self->samplesPlayed_.fetch_add(got, std::memory_order_relaxed);
+    if (got < frameCount) {
+        std::memset(out + got, 0, (frameCount - got) * sizeof(int16_t));
+        if (self->expectMore_.load(std::memory_order_relaxed)) {
+            self->underruns_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return paContinue;
+}
+
+bool AudioPlayer::open(int deviceId, double preferredRate, double bufferSeconds) {
+    close();
+
+    PaDeviceIndex dev = (deviceId >= 0) ? deviceId : Pa_GetDefaultOutputDevice();
+    if (dev == paNoDevice) {
+        std::cerr << "[audio] No output device found.\n";
+        return false;
+    }
+
+    double rate = Audio::pickSupportedRate(dev, true, preferredRate);
+    if (rate <= 0) {
+        std::cerr << "[audio] Could not find any supported sample rate for playback on device " << dev << ".\n";
+        return false;
+    }
+    sampleRate_ = rate;
+    ring_.reset(static_cast<size_t>(std::max(1.0, bufferSeconds) * rate));
+
+    const PaDeviceInfo* di = Pa_GetDeviceInfo(dev);
+    PaStreamParameters outParams{};
+    outParams.device = dev;
+    outParams.channelCount = 1;
+    outParams.sampleFormat = paInt16;
+    outParams.suggestedLatency = di ? di->defaultLowOutputLatency : 0.050;
+    outParams.hostApiSpecificStreamInfo = nullptr;
+
+    PaError err = Pa_OpenStream(&stream_, nullptr, &outParams, rate, paFramesPerBufferUnspecified,
+                                paClipOff, &AudioPlayer::paCallback, this);
+    if (err != paNoError || !stream_) {
+        std::cerr << "[audio] PortAudio error (Pa_OpenStream, playback): " << Pa_GetErrorText(err) << "\n";
+        Audio::forgetDevice(dev); // stale cached answer; probe again next time
+        stream_ = nullptr;
+        return false;
+    }
+    if ((err = Pa_StartStream(stream_)) != paNoError) {
+        std::cerr << "[audio] PortAudio error (Pa_StartStream, playback): " << Pa_GetErrorText(err) << "\n";
+        Pa_CloseStream(stream_);
+        stream_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AudioPlayer::close() {
+    if (!stream_) return;
+    flushGeneration_.fetch_add(1);
+    Pa_AbortStream(stream_);
+    Pa_CloseStream(stream_);
+    stream_ = nullptr;
+    ring_.clear();
+    expectMore_ = false;
+}
+
+bool AudioPlayer::enqueue(const int16_t* pcm, size_t samples, double rate, bool more) {
+    if (!stream_) return false;
+
+    const uint64_t generation = flushGeneration_.load();
+    if (rate != sampleRate_) {
+        // Chunks of one utterance share the filter state, so there is no
+        // click at chunk boundaries; a new utterance or a flush starts over.
+        if (resampler_.rateIn() != rate || resampler_.rateOut() != sampleRate_) {
+            resampler_.configure(rate, sampleRate_);
+        } else if (!resamplerContinues_ || resamplerGeneration_ != generation) {
+            resampler_.reset();
+        }
+        resampled_.clear();
+        resampler_.process(pcm, samples, resampled_);
+        if (!more) {
+            resampler_.flush(resampled_);
+        }
+        resamplerContinues_ = more;
+        resamplerGeneration_ = generation;
+        pcm = resampled_.data();
+        samples = resampled_.size();
+    }
+
+    expectMore_ = true;
+    size_t done = 0;
+    while (done < samples) {
+        if (flushGeneration_.load() != generation || !stream_) {
+            return false;
+        }
+        size_t n = ring_.write(pcm + done, samples - done);
+        done += n;
+        samplesQueued_.fetch_add(n, std::memory_order_relaxed);
+        if (done < samples) {
+            // Queue full: wait for the callback to make room.
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    expectMore_ = more;
+    return true;
+}
+
+void AudioPlayer::flush() {
+    if (!stream_) return;
+    flushGeneration_.fetch_add(1);
+    expectMore_ = false;
+    flushRequested_.store(true, std::memory_order_release);
+    // Wait for the callback to acknowledge so that audio queued after
+    // flush() returns is not dropped by the pending request.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+    while (flushRequested_.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool AudioPlayer::isPlaying() const {
+    return ring_.readAvailable() > 0;
+}
+
+bool AudioPlayer::waitIdle(int timeoutMs) {
+    auto start = std::chrono::steady_clock::now();
+    while (isPlaying()) {
+        if (!stream_) return false;
+        if (timeoutMs >= 0 && std::chrono::steady_clock::now() - start > std::chrono::milliseconds(timeoutMs)) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    // The last buffer is still in the device; let it drain.
+    const PaStreamInfo* info = stream_ ? Pa_GetStreamInfo(stream_) : nullptr;
+    if (info && info->outputLatency > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(info->outputLatency * 1000)));
+    }
+    return true;
+}
+
+double AudioPlayer::playedSeconds() const {
+    return sampleRate_ > 0 ? samplesPlayed_.load() / sampleRate_ : 0.0;
+}
+
+double AudioPlayer::queuedSeconds() const {
+    return sampleRate_ > 0 ? ring_.readAvailable() / sampleRate_ : 0.0;
+}
+
+PlaybackStats AudioPlayer::stats() const {
+    PlaybackStats s;
+    s.samplesQueued = samplesQueued_.load(std::memory_order_relaxed);
+    s.samplesPlayed = samplesPlayed_.load(std::memory_order_relaxed);
+    s.samplesFlushed = samplesFlushed_.load(std::memory_order_relaxed);
+    s.underruns = underruns_.load(std::memory_order_relaxed);
+    return s;
+}
+
+#endif // WITH_AUDIO
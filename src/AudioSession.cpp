@@ -0,0 +1,44 @@
+#include "AudioSession.h"
+#include <iostream>
+#include <chrono>
+
+#ifdef WITH_AUDIO
+
+bool AudioSession::open(const AudioSessionConfig& cfg) {
+    close();
+    auto t0 = std::chrono::steady_clock::now();
+
+    if (cfg.withInput) {
+        double rate = cfg.inputRate;
+        capture_.setPreRollMs(cfg.preRollMs);
+        if (!capture_.open(cfg.inputDevice, rate, cfg.captureRingSeconds)) {
+            std::cerr << "[audio] Could not open the input stream." << std::endl;
+            return false;
+        }
+        capture_.disarm();
+        if (!capture_.start()) {
+            std::cerr << "[audio] Could not start the input stream." << std::endl;
+            capture_.close();
+            return false;
+        }
+    }
+
+    if (cfg.withOutput && !player_.open(cfg.outputDevice, cfg.outputRate, cfg.playbackBufferSeconds)) {
+        std::cerr << "[audio] Could not open the output stream, audio will not be played." << std::endl;
+    }
+
+    setupMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[audio] Session ready in " << static_cast<int>(setupMs_) << " ms (in: ";
+    if (hasInput()) std::cout << inputRate() << " Hz"; else std::cout << "none";
+    std::cout << ", out: ";
+    if (hasOutput()) std::cout << outputRate() << " Hz"; else std::cout << "none";
+    std::cout << ")" << std::endl;
+    return true;
+}
+
+void AudioSession::close() {
+    capture_.close();
+    player_.close();
+}
+
+#endif // WITH_AUDIO
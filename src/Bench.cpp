@@ -0,0 +1,201 @@
+#include "Bench.h"
+#include "Utils.h"
+#include "Resampler.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <ctime>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+
+#ifdef WITH_VOSK
+#include "AsrVosk.h"
+#include "WakeWord.h"
+
+// A quiet room: low broadband noise with a slow hum and an occasional short
+// clatter so that the energy gate gets exercised now and then.
+static std::vector<int16_t> makeIdleAudio(int seconds, double sampleRate) {
+    std::vector<int16_t> pcm(static_cast<size_t>(seconds * sampleRate));
+    std::mt19937 gen(42);
+    std::normal_distribution<double> noise(0.0, 60.0);
+    const size_t clatterEvery = static_cast<size_t>(20 * sampleRate);
+    const size_t clatterLen = static_cast<size_t>(0.15 * sampleRate);
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        double t = i / sampleRate;
+        double v = noise(gen) + 40.0 * std::sin(2.0 * 3.14159265358979 * 50.0 * t);
+        if (i % clatterEvery < clatterLen) {
+            v += noise(gen) * 40.0;
+        }
+        pcm[i] = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, v)));
+    }
+    return pcm;
+}
+
+int runWakeWordBench(AsrVosk& asr, const WakeWordConfig& cfg, const std::string& wavPath, int seconds) {
+    std::vector<int16_t> pcm;
+    double sampleRate = 16000.0;
+    if (!wavPath.empty()) {
+        uint32_t sr = 0;
+        if (!loadWav(wavPath, pcm, sr)) return 1;
+        sampleRate = sr;
+    } else {
+        pcm = makeIdleAudio(seconds, sampleRate);
+    }
+    if (pcm.empty()) {
+        std::cerr << "[bench] No audio to process." << std::endl;
+        return 1;
+    }
+
+    WakeWordDetector detector(asr, cfg);
+    if (!detector.isAvailable()) {
+        std::cerr << "[bench] Wake-word detector unavailable: " << detector.lastError() << std::endl;
+        return 1;
+    }
+
+    // Same 10 ms framing as the live capture path.
+    const size_t frame = static_cast<size_t>(sampleRate / 100.0);
+    std::clock_t cpuStart = std::clock();
+    auto wallStart = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos + frame <= pcm.size(); pos += frame) {
+        detector.process(pcm.data() + pos, frame, sampleRate);
+    }
+    double cpuSec = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double audioSec = pcm.size() / sampleRate;
+
+    WakeWordStats s = detector.stats();
+    std::cout << std::fixed << std::setprecision(3)
+              << "[bench] wake word: \"" << cfg.word << "\"\n"
+              << "[bench] audio: " << audioSec << " s (" << (wavPath.empty() ? "synthetic idle" : wavPath) << ")\n"
+              << "[bench] wall: " << wallSec << " s, cpu: " << cpuSec << " s\n"
+              << "[bench] cpu load: " << (100.0 * cpuSec / audioSec) << " % of one core\n"
+              << "[bench] cpu per hour of audio: " << (cpuSec * 3600.0 / audioSec) << " s\n"
+              << "[bench] frames decoded: " << s.framesDecoded << "/" << s.framesSeen
+              << " (" << (s.framesSeen ? 100.0 * s.framesDecoded / s.framesSeen : 0.0) << " %), bursts: " << s.bursts
+              << ", candidates: " << s.candidates << ", detections: " << s.detections << std::endl;
+    return 0;
+}
+#endif // WITH_VOSK
+
+// The linear interpolator that Utils::resample() used before the polyphase
+// resampler, kept here as the baseline.
+static std::vector<int16_t> linearResample(const std::vector<int16_t>& pcm_in, double sample_rate_in, double sample_rate_out) {
+    double ratio = sample_rate_in / sample_rate_out;
+    size_t out_len = static_cast<size_t>(pcm_in.size() / ratio);
+    std::vector<int16_t> pcm_out(out_len);
+    for (size_t i = 0; i < out_len; ++i) {
+        double in_idx_f = i * ratio;
+        size_t in_idx_i = static_cast<size_t>(in_idx_f);
+        double frac = in_idx_f - in_idx_i;
+        if (in_idx_i + 1 < pcm_in.size()) {
+            pcm_out[i] = static_cast<int16_t>(pcm_in[in_idx_i] * (1.0 - frac) + pcm_in[in_idx_i + 1] * frac);
+        } else {
+            pcm_out[i] = pcm_in.back();
+        }
+    }
+    return pcm_out;
+}
+
+static std::vector<int16_t> makeTone(double freq, double seconds, double sampleRate, double amplitude) {
+    std::vector<int16_t> pcm(static_cast<size_t>(seconds * sampleRate));
+    for (size_t i = 0; i < pcm.size(); ++i) {
+        pcm[i] = static_cast<int16_t>(amplitude * std::sin(2.0 * 3.14159265358979 * freq * i / sampleRate));
+    }
+    return pcm;
+}
+
+static double rmsOf(const std::vector<int16_t>& pcm, size_t skip) {
+    double acc = 0.0;
+    size_t n = 0;
+    for (size_t i = skip; i + skip < pcm.size(); ++i, ++n) acc += static_cast<double>(pcm[i]) * pcm[i];
+    return n ? std::sqrt(acc / n) : 0.0;
+}
+
+// Test tone for aliasDb(): between the output and input Nyquist
+// frequencies, so it exists in the input but must be removed. Kept off the
+// midpoint, which for 3:1 lands on the output rate and aliases to DC.
+static double aliasToneHz(double rateIn, double rateOut) {
+    return rateOut / 2.0 + 0.75 * (rateIn - rateOut) / 2.0;
+}
+
+// Level of the aliasToneHz() tone after conversion, relative to its input
+// level. Only meaningful when decimating.
+template<typename Fn>
+static double aliasDb(Fn convert, double rateIn, double rateOut) {
+    const double freq = aliasToneHz(rateIn, rateOut);
+    auto tone = makeTone(freq, 1.0, rateIn, 10000.0);
+    auto out = convert(tone, rateIn, rateOut);
+    double in = rmsOf(tone, 0);
+    double res = std::max(rmsOf(out, static_cast<size_t>(rateOut / 20)), 1e-3);
+    return 20.0 * std::log10(res / in);
+}
+
+int runResampleBench(const std::string& pairs, int seconds) {
+    std::vector<std::pair<double, double>> rates;
+    std::stringstream ss(pairs.empty() ? "48000:16000,44100:16000,22050:48000" : pairs);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            std::cerr << "[bench] Expected <in:out>, got: " << item << std::endl;
+            return 1;
+        }
+        rates.emplace_back(std::atof(item.substr(0, colon).c_str()), std::atof(item.substr(colon + 1).c_str()));
+    }
+
+    auto polyphase = [](const std::vector<int16_t>& pcm, double in, double out) {
+        return resamplePcm(pcm.data(), pcm.size(), in, out);
+    };
+    auto generic = [](const std::vector<int16_t>& pcm, double in, double out) {
+        StreamResampler rs;
+        rs.configure(in, out, ResamplerPath::Generic);
+        std::vector<int16_t> res;
+        rs.process(pcm.data(), pcm.size(), res);
+        rs.flush(res);
+        return res;
+    };
+
+    std::cout << "[bench] resampler kernel: " << resamplerKernelName() << "\n";
+    for (const auto& r : rates) {
+        if (r.first <= 0 || r.second <= 0) {
+            std::cerr << "[bench] Invalid rate pair." << std::endl;
+            return 1;
+        }
+        std::mt19937 gen(7);
+        std::normal_distribution<double> noise(0.0, 3000.0);
+        std::vector<int16_t> pcm(static_cast<size_t>(seconds * r.first));
+        for (auto& v : pcm) v = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, noise(gen))));
+
+        auto timeIt = [&](auto fn) {
+            auto t0 = std::chrono::steady_clock::now();
+            auto out = fn(pcm, r.first, r.second);
+            double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            return std::make_pair(sec, out.size());
+        };
+        polyphaseBank(r.first, r.second); // exclude the one-off filter design
+        auto lin = timeIt(linearResample);
+        auto gsec = timeIt(generic);
+        auto poly = timeIt(polyphase);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "[bench] " << static_cast<long>(r.first) << " -> " << static_cast<long>(r.second) << " Hz, " << seconds << " s of audio\n"
+                  << "[bench]   linear:    " << (pcm.size() / lin.first / 1e6) << " Msamples/s ("
+                  << (seconds / lin.first) << "x realtime)\n"
+                  << "[bench]   generic:   " << (pcm.size() / gsec.first / 1e6) << " Msamples/s ("
+                  << (seconds / gsec.first) << "x realtime)\n"
+                  << "[bench]   selected:  " << (pcm.size() / poly.first / 1e6) << " Msamples/s ("
+                  << (seconds / poly.first) << "x realtime) [" << StreamResampler(r.first, r.second).kernelName() << "]\n";
+        if (r.second < r.first) {
+            std::cout << "[bench]   alias at " << static_cast<long>(aliasToneHz(r.first, r.second)) << " Hz: linear "
+                      << aliasDb(linearResample, r.first, r.second) << " dB, polyphase "
+                      << aliasDb(polyphase, r.first, r.second) << " dB\n";
+        }
+    }
+    std::cout << std::flush;
+    return 0;
+}
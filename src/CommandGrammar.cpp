@@ -0,0 +1,153 @@
+#include "CommandGrammar.h"
+#include "AsrVosk.h"
+#include "Memory.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include "nlohmann/json.hpp"
+
+#ifdef WITH_VOSK
+#include <vosk_api.h>
+
+namespace {
+// Spoken prefixes of the free-text commands in parseIntent(), longest
+// first. Their body is open vocabulary and decodes as [unk] here.
+const char* const kFreeTextPrefixes[] = {
+    "ajoute une note", "add note",
+    "rappelle-moi de", "rappelle-moi", "remind me to", "remind me", "rappel",
+};
+
+// Spoken values for "set <key> <value>", besides the ones already stored.
+const char* const kCommonValues[] = {
+    "on", "off", "yes", "no", "oui", "non",
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten",
+    "zéro", "un", "deux", "trois", "quatre", "cinq", "sept", "huit", "neuf", "dix",
+};
+
+std::string toLowerAscii(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return std::tolower(c); });
+    return s;
+}
+
+bool isSingleWord(const std::string& s) {
+    return !s.empty() && s.find_first_of(" \t=") == std::string::npos;
+}
+}
+
+CommandGrammar::CommandGrammar(AsrVosk& asr, double minConfidence)
+    : asr_(asr), minConfidence_(minConfidence) {}
+
+bool CommandGrammar::update(const MemoryStore& mem) {
+    if (built_ && mem.factsRevision() == factsRevision_) return false;
+    factsRevision_ = mem.factsRevision();
+    built_ = true;
+    if (!asr_.isAvailable() || asr_.model() == nullptr) return false;
+
+    auto known = [this](const std::string& phrase) {
+        std::istringstream iss(phrase);
+        std::string w;
+        while (iss >> w) {
+            if (vosk_model_find_word(asr_.model(), w.c_str()) < 0) return false;
+        }
+        return true;
+    };
+
+    std::set<std::string> keys, values;
+    for (const char* v : kCommonValues) values.insert(v);
+    for (const auto& fact : mem.listFacts()) {
+        // parseIntent() splits "set key value" at the first space, so only
+        // single-word keys can be spoken.
+        std::string key = toLowerAscii(fact.first);
+        std::string value = toLowerAscii(fact.second);
+        if (isSingleWord(key)) keys.insert(key);
+        if (isSingleWord(value)) values.insert(value);
+    }
+
+    nlohmann::json phrases = nlohmann::json::array();
+    for (const char* prefix : kFreeTextPrefixes) {
+        if (known(prefix)) phrases.push_back(prefix);
+    }
+    if (known("set")) {
+        for (const auto& key : keys) {
+            if (!known(key)) continue;
+            for (const auto& value : values) {
+                if (known(value)) phrases.push_back("set " + key + " " + value);
+            }
+        }
+    }
+    const size_t count = phrases.size();
+    phrases.push_back("[unk]");
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    json_ = phrases.dump();
+    phrases_ = count;
+    ++version_;
+    std::cout << "[asr] Command grammar: " << count << " phrases over " << keys.size() << " fact keys" << std::endl;
+    return true;
+}
+
+std::string CommandGrammar::grammar(uint64_t& version) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    version = version_;
+    return json_;
+}
+
+size_t CommandGrammar::phraseCount() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return phrases_;
+}
+
+bool CommandGrammar::accepts(const AsrResult& result) const {
+    if (result.text.empty() || result.words.empty()) return false;
+    if (result.text.find("[unk]") != std::string::npos) return false;
+    for (const auto& w : result.words) {
+        if (w.conf < minConfidence_) return false;
+    }
+    // A bare "add note" parses as a note without text: never save that.
+    Intent intent = parseIntent(result.text);
+    if ((intent.type == IntentType::NOTE_ADD || intent.type == IntentType::REMINDER_ADD) && intent.text.empty()) {
+        return false;
+    }
+    return intent.type != IntentType::NONE;
+}
+
+bool CommandGrammar::spliceFreeText(const AsrResult& command, AsrResult& full) const {
+    for (const char* prefix : kFreeTextPrefixes) {
+        std::istringstream iss(prefix);
+        std::vector<std::string> words;
+        std::string w;
+        while (iss >> w) words.push_back(w);
+        // The prefix, confidently heard, then a body the grammar cannot spell.
+        if (command.words.size() <= words.size()) continue;
+        bool match = true;
+        for (size_t i = 0; i < words.size() && match; ++i) {
+            match = command.words[i].word == words[i] && command.words[i].conf >= minConfidence_;
+        }
+        if (!match || command.words[words.size()].word != "[unk]") continue;
+
+        if (toLowerAscii(full.text).rfind(std::string(prefix) + ' ', 0) == 0) return false;   // the full decode got it too
+
+        // Both recognizers saw the same audio from open(), so their times line up.
+        const double bodyStart = command.words[words.size() - 1].end;
+        AsrResult spliced;
+        spliced.words.assign(command.words.begin(), command.words.begin() + words.size());
+        for (const auto& fw : full.words) {
+            if ((fw.start + fw.end) / 2.0 >= bodyStart) spliced.words.push_back(fw);
+        }
+        if (spliced.words.size() == words.size()) return false;   // no body
+        for (const auto& sw : spliced.words) {
+            if (!spliced.text.empty()) spliced.text += ' ';
+            spliced.text += sw.word;
+        }
+        if (parseIntent(spliced.text).type == IntentType::NONE) return false;
+        spliced.decodeMs = full.decodeMs;
+        spliced.rebuildJson();
+        full = std::move(spliced);
+        return true;
+    }
+    return false;
+}
+
+#endif // WITH_VOSK
@@ -0,0 +1,68 @@
+#include "ConversationContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Role markers and separators the chat template adds around each message.
+const size_t kMessageOverhead = 4;
+}
+
+ConversationContext::ConversationContext(const ContextConfig& cfg) : cfg_(cfg) {
+    cfg_.trimTo = std::max(0.0, std::min(1.0, cfg_.trimTo));
+}
+
+size_t ConversationContext::estimateTokens(const std::string& text) const {
+    return static_cast<size_t>(std::ceil(text.size() / bytesPerToken_)) + kMessageOverhead;
+}
+
+size_t ConversationContext::turnTokens(const Turn& t) const {
+    return estimateTokens(t.user) + estimateTokens(t.assistant);
+}
+
+std::vector<ChatMessage> ConversationContext::messagesFor(const std::string& userMessage) {
+    const size_t fixed = estimateTokens(cfg_.systemPrompt) + estimateTokens(userMessage);
+    size_t history = 0;
+    for (const auto& t : turns_) history += turnTokens(t);
+
+    lastEvicted_ = 0;
+    if (fixed + history > cfg_.maxTokens) {
+        const size_t target = static_cast<size_t>(cfg_.maxTokens * cfg_.trimTo);
+        while (!turns_.empty() && fixed + history > target) {
+            history -= turnTokens(turns_.front());
+            turns_.pop_front();
+            ++lastEvicted_;
+        }
+        totalEvicted_ += lastEvicted_;
+    }
+
+    std::vector<ChatMessage> messages;
+    messages.reserve(2 + 2 * turns_.size());
+    messages.push_back({"system", cfg_.systemPrompt});
+    for (const auto& t : turns_) {
+        messages.push_back({"user", t.user});
+        messages.push_back({"assistant", t.assistant});
+    }
+    messages.push_back({"user", userMessage});
+
+    promptBytes_ = 0;
+    for (const auto& m : messages) promptBytes_ += m.content.size();
+    promptMessages_ = messages.size();
+    promptEstimate_ = fixed + history;
+    return messages;
+}
+
+std::string ConversationContext::lastExchange() const {
+    if (turns_.empty()) return std::string();
+    return turns_.back().user + '\n' + turns_.back().assistant;
+}
+
+void ConversationContext::commit(const std::string& userMessage, const std::string& reply, int promptTokens) {
+    if (promptTokens > 0 && promptBytes_ > 0) {
+        const double overhead = static_cast<double>(kMessageOverhead * promptMessages_);
+        const double content = std::max(1.0, promptTokens - overhead);
+        const double observed = std::max(1.5, std::min(8.0, promptBytes_ / content));
+        bytesPerToken_ = 0.7 * bytesPerToken_ + 0.3 * observed;
+    }
+    if (cfg_.maxTokens == 0) return;
+    turns_.push_back({userMessage, reply});
+}
@@ -38,6 +38,9 @@ EnvConfig loadEnvFile(const std::string& path) {
         if (const char* p = std::getenv("WAKE_WORD")) cfg.wakeWord = p;
         if (const char* p = std::getenv("ASR_ENGINE")) cfg.asrEngine = p;
         if (const char* p = std::getenv("TTS_ENGINE")) cfg.ttsEngine = p;
+        if (const char* p = std::getenv("WHISPER_MODEL")) cfg.whisperModel = p;
+        if (const char* p = std::getenv("WHISPER_THREADS")) cfg.whisperThreads = std::atoi(p);
+        if (const char* p = std::getenv("PIPER_THREADS")) cfg.piperThreads = std::atoi(p);
         return cfg;
     }
 
@@ -57,6 +60,9 @@ EnvConfig loadEnvFile(const std::string& path) {
         else if (key == "WAKE_WORD") cfg.wakeWord = val;
         else if (key == "ASR_ENGINE") cfg.asrEngine = val;
         else if (key == "TTS_ENGINE") cfg.ttsEngine = val;
+        else if (key == "WHISPER_MODEL") cfg.whisperModel = val;
+        else if (key == "WHISPER_THREADS") cfg.whisperThreads = std::atoi(val.c_str());
+        else if (key == "PIPER_THREADS") cfg.piperThreads = std::atoi(val.c_str());
     }
     return cfg;
 }
@@ -64,6 +64,7 @@ bool MemoryStore::ensureParentDir() const {
 
 bool MemoryStore::load() {
     ensureParentDir();
+    ++factsRevision_;
     if (!std::filesystem::exists(path_)) {
         return true; // Use default empty structure, will be saved on first write
     }
@@ -115,6 +116,7 @@ std::string MemoryStore::genId() {
 
 void MemoryStore::set(const std::string& key, const std::string& value) {
     j_["facts"][key] = value;
+    ++factsRevision_;
 }
 
 bool MemoryStore::get(const std::string& key, std::string& value) const {
@@ -128,6 +130,7 @@ bool MemoryStore::get(const std::string& key, std::string& value) const {
 bool MemoryStore::del(const std::string& key) {
     if (j_.contains("facts") && j_["facts"].contains(key)) {
         j_["facts"].erase(key);
+        ++factsRevision_;
         return true;
     }
     return false;
@@ -1,104 +1,410 @@
-
 #include "OpenAIClient.h"
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <algorithm>
 #include "nlohmann/json.hpp"
 
 #ifdef HAVE_CURL
 #include <curl/curl.h>
-#endif
-
-OpenAIClient::OpenAIClient(std::string apiBase, std::string apiKey, std::string model, bool offline)
-: m_apiBase(std::move(apiBase)), m_apiKey(std::move(apiKey)), m_model(std::move(model)), m_offline(offline) {}
-
-#ifdef HAVE_CURL
 static size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
     auto* out = reinterpret_cast<std::string*>(userdata);
     out->append(ptr, size * nmemb);
     return size * nmemb;
 }
-#endif
 
-ChatResult OpenAIClient::chatOnce(const std::string& userMessage) const {
-#ifndef HAVE_CURL
-    // Offline echo mode
-    ChatResult r;
-    r.ok = true;
-    r.text = "(offline) Echo: " + userMessage;
-    return r;
-#else
-    if (m_offline) {
-        ChatResult r;
-        r.ok = true;
-        r.text = "(offline) Echo: " + userMessage;
-        return r;
-    }
-
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        return ChatResult{false, "", "curl_easy_init failed"};
-    }
-
-    std::string url = m_apiBase;
+static std::string chatUrl(std::string url) {
     if (!url.empty() && url.back() == '/') url.pop_back();
-    url += "/chat/completions";
+    return url + "/chat/completions";
+}
 
+// Messages are serialized in order and verbatim, so a conversation that only
+// grows at the end produces a request whose prefix is byte-identical to the
+// previous one, which lets the server reuse its prompt cache.
+static std::string chatPayload(const std::string& model, const std::vector<ChatMessage>& messages, bool stream) {
+    nlohmann::json list = nlohmann::json::array();
+    for (const auto& m : messages) {
+        list.push_back({{"role", m.role}, {"content", m.content}});
+    }
     nlohmann::json payload = {
-        {"model", m_model},
-        {"stream", false},
-        {"messages", {
-            {{"role", "system"}, {"content", "You are a concise assistant. Reply in the user's language."}},
-            {{"role", "user"}, {"content", userMessage}}
-        }}
+        {"model", model},
+        {"stream", stream},
+        {"messages", list}
     };
-    const std::string payload_str = payload.dump();
+    // Ask for a final usage chunk, so tokens/s uses the server's token count.
+    if (stream) payload["stream_options"] = {{"include_usage", true}};
+    return payload.dump();
+}
 
+static struct curl_slist* chatHeaders(const std::string& apiKey, bool stream) {
     struct curl_slist* headers = nullptr;
     headers = curl_slist_append(headers, "Content-Type: application/json");
-    if (!m_apiKey.empty() && m_apiKey != "EMPTY") {
-        std::string auth = std::string("Authorization: Bearer ") + m_apiKey;
+    if (stream) headers = curl_slist_append(headers, "Accept: text/event-stream");
+    if (!apiKey.empty() && apiKey != "EMPTY") {
+        std::string auth = std::string("Authorization: Bearer ") + apiKey;
         headers = curl_slist_append(headers, auth.c_str());
     }
+    return headers;
+}
+
+static std::string httpError(long code, const std::string& body) {
+    std::string error_msg = "HTTP status " + std::to_string(code);
+    nlohmann::json j = nlohmann::json::parse(body, nullptr, false);
+    if (!j.is_discarded() && j.contains("error") && j["error"].is_object() && j["error"].contains("message")) {
+        error_msg += ": " + j["error"]["message"].get<std::string>();
+    }
+    return error_msg;
+}
+
+// One easy handle reused for every request: libcurl keeps its connection
+// open between requests and reuses it as long as the server allows. The
+// share object holds the DNS and TLS session caches (and the connection
+// pool, where supported), so they also outlive a handle that has to be
+// recreated.
+struct OpenAIClient::Connection {
+    CURL* easy = nullptr;
+    CURLSH* share = nullptr;
+    struct curl_slist* jsonHeaders = nullptr;
+    struct curl_slist* sseHeaders = nullptr;
+    const std::string url;
+    std::mutex mutex;                               // one request at a time on the handle
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+    Connection(const std::string& apiBase, const std::string& apiKey, bool http2) : url(chatUrl(apiBase)) {
+        static std::once_flag curlInit;
+        std::call_once(curlInit, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+        share = curl_share_init();
+        if (share) {
+            curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+            curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+            curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+        }
+        jsonHeaders = chatHeaders(apiKey, false);
+        sseHeaders = chatHeaders(apiKey, true);
+
+        easy = curl_easy_init();
+        if (!easy) return;
+        curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        if (share) curl_easy_setopt(easy, CURLOPT_SHARE, share);
+        curl_easy_setopt(easy, CURLOPT_TCP_NODELAY, 1L);
+        // Probe idle connections so a dead one is noticed before reuse.
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPIDLE, 30L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPINTVL, 15L);
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, http2 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1);
+    }
+
+    ~Connection() {
+        if (easy) curl_easy_cleanup(easy);
+        if (share) curl_share_cleanup(share);
+        curl_slist_free_all(jsonHeaders);
+        curl_slist_free_all(sseHeaders);
+    }
+
+    static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* user) {
+        static_cast<Connection*>(user)->shareLocks[data].lock();
+    }
+    static void unlockShare(CURL*, curl_lock_data data, void* user) {
+        static_cast<Connection*>(user)->shareLocks[data].unlock();
+    }
+
+    // libcurl calls this about once a second while idle and after every
+    // read while data flows; a non-zero return aborts the transfer.
+    static int progress(void* user, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return static_cast<const std::atomic<bool>*>(user)->load() ? 1 : 0;
+    }
 
-    std::string response;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    // POSTs `payload`, handing the body to `write`; fills in the HTTP timings
+    // of `r`. The transfer is aborted when `cancel` is set, and fails with
+    // CURLE_OPERATION_TIMEDOUT after timeoutMs (0: no limit).
+    CURLcode perform(const std::string& payload, bool stream, curl_write_callback write, void* data,
+                     const std::atomic<bool>* cancel, long timeoutMs, long& code, ChatResult& r) {
+        std::lock_guard<std::mutex> lk(mutex);
+        code = 0;
+        if (cancel && cancel->load()) return CURLE_ABORTED_BY_CALLBACK;   // cancelled while queued
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, timeoutMs);
+        curl_easy_setopt(easy, CURLOPT_NOPROGRESS, cancel ? 0L : 1L);
+        curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, cancel ? progress : nullptr);
+        curl_easy_setopt(easy, CURLOPT_XFERINFODATA, const_cast<std::atomic<bool>*>(cancel));
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, stream ? sseHeaders : jsonHeaders);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, payload.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(payload.size()));
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, data);
 
-    CURLcode res = curl_easy_perform(curl);
-    long code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+        CURLcode res = curl_easy_perform(easy);
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+        double total = 0, connect = 0, tls = 0, ttfb = 0;
+        long connects = 0, version = 0;
+        curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME, &total);
+        curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME, &connect);
+        curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME, &tls);
+        curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME, &ttfb);
+        curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+        curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &version);
+        r.totalMs = total * 1000.0;
+        r.connectMs = std::max(connect, tls) * 1000.0;
+        r.ttfbMs = ttfb * 1000.0;
+        r.reusedConnection = res == CURLE_OK && connects == 0;
+        r.httpVersion = version == CURL_HTTP_VERSION_2_0 ? 2 : version != 0 ? 1 : 0;
+        return res;
+    }
+};
+
+// Token counts from an OpenAI-style "usage" object.
+static void applyUsage(const nlohmann::json& usage, ChatResult& r) {
+    auto count = [](const nlohmann::json& o, const char* key, int fallback) {
+        return o.contains(key) && o[key].is_number_integer() ? o[key].get<int>() : fallback;
+    };
+    r.tokens = count(usage, "completion_tokens", r.tokens);
+    r.promptTokens = count(usage, "prompt_tokens", r.promptTokens);
+    if (usage.contains("prompt_tokens_details") && usage["prompt_tokens_details"].is_object()) {
+        r.cachedTokens = count(usage["prompt_tokens_details"], "cached_tokens", r.cachedTokens);
+    }
+}
+
+namespace {
+// Incremental parser for the "data: {...}" events of a streamed completion.
+struct SseStream {
+    const OpenAIClient::DeltaFn* onDelta = nullptr;
+    const std::atomic<bool>* cancel = nullptr;
+    std::chrono::steady_clock::time_point start;
+    std::string pending;        // bytes after the last complete line
+    std::string raw;            // body as received, until the first event
+    std::string text;
+    std::string error;
+    bool sawEvent = false;
+    bool done = false;
+    int deltas = 0;
+    nlohmann::json usage;       // from the final chunk, when the server sends one
+    double firstTokenMs = -1.0;
+    double lastTokenMs = 0.0;
+
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void line(std::string l) {
+        if (!l.empty() && l.back() == '\r') l.pop_back();
+        if (l.compare(0, 5, "data:") != 0) return;   // comments, event names, blank separators
+        sawEvent = true;
+        size_t p = 5;
+        while (p < l.size() && l[p] == ' ') ++p;
+        if (l.compare(p, std::string::npos, "[DONE]") == 0) {
+            done = true;
+            return;
+        }
+        nlohmann::json j = nlohmann::json::parse(l.begin() + p, l.end(), nullptr, false);
+        if (j.is_discarded() || !j.is_object()) return;
+        if (j.contains("error")) {
+            const auto& e = j["error"];
+            error = e.is_object() && e.contains("message") && e["message"].is_string()
+                  ? e["message"].get<std::string>() : e.dump();
+            return;
+        }
+        if (j.contains("usage") && j["usage"].is_object()) usage = j["usage"];
+        if (!j.contains("choices") || !j["choices"].is_array() || j["choices"].empty()) return;
+        const auto& choice = j["choices"][0];
+        if (!choice.contains("delta") || !choice["delta"].is_object()) return;
+        const auto& delta = choice["delta"];
+        if (!delta.contains("content") || !delta["content"].is_string()) return;
+        deliver(delta["content"].get<std::string>());
+    }
 
-    if (res != CURLE_OK) {
-        return ChatResult{false, "", std::string("curl error: ") + curl_easy_strerror(res)};
+    void deliver(const std::string& piece) {
+        if (piece.empty()) return;
+        const double now = elapsedMs();
+        if (firstTokenMs < 0) firstTokenMs = now;
+        lastTokenMs = now;
+        ++deltas;
+        text += piece;
+        if (*onDelta) (*onDelta)(piece);
     }
+};
 
-    try {
-        nlohmann::json j = nlohmann::json::parse(response);
-        if (code < 200 || code >= 300) {
-            std::string error_msg = "HTTP status " + std::to_string(code);
-            if (j.contains("error") && j["error"].is_object() && j["error"].contains("message")) {
-                error_msg += ": " + j["error"]["message"].get<std::string>();
+size_t sse_write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* s = reinterpret_cast<SseStream*>(userdata);
+    const size_t n = size * nmemb;
+    if (s->cancel && s->cancel->load()) return 0;   // stop before the next delta is delivered
+    if (!s->sawEvent) s->raw.append(ptr, n);
+    s->pending.append(ptr, n);
+    size_t begin = 0, nl;
+    while ((nl = s->pending.find('\n', begin)) != std::string::npos) {
+        s->line(s->pending.substr(begin, nl - begin));
+        begin = nl + 1;
+    }
+    s->pending.erase(0, begin);
+    return n;
+}
+}
+#else
+struct OpenAIClient::Connection {};
+#endif
+
+OpenAIClient::OpenAIClient(std::string apiBase, std::string apiKey, std::string model, bool offline, bool http2)
+: m_apiBase(std::move(apiBase)), m_apiKey(std::move(apiKey)), m_model(std::move(model)), m_offline(offline) {
+#ifdef HAVE_CURL
+    if (!m_offline) m_conn = std::make_unique<Connection>(m_apiBase, m_apiKey, http2);
+#else
+    (void)http2;
+#endif
+}
+
+OpenAIClient::~OpenAIClient() = default;
+
+// The fixed system prompt and a single user message.
+static std::vector<ChatMessage> singleTurn(const std::string& userMessage) {
+    return {{"system", OpenAIClient::kSystemPrompt}, {"user", userMessage}};
+}
+
+ChatResult OpenAIClient::chatOnce(const std::string& userMessage) const {
+    return request(singleTurn(userMessage), false, DeltaFn(), nullptr, m_timeoutSeconds);
+}
+
+ChatResult OpenAIClient::chatOnce(const std::vector<ChatMessage>& messages) const {
+    return request(messages, false, DeltaFn(), nullptr, m_timeoutSeconds);
+}
+
+ChatResult OpenAIClient::chatStream(const std::string& userMessage, const DeltaFn& onDelta) const {
+    return request(singleTurn(userMessage), true, onDelta, nullptr, m_timeoutSeconds);
+}
+
+ChatResult OpenAIClient::chatStream(const std::vector<ChatMessage>& messages, const DeltaFn& onDelta) const {
+    return request(messages, true, onDelta, nullptr, m_timeoutSeconds);
+}
+
+ChatHandle OpenAIClient::chatAsync(const std::string& userMessage, ChatOptions opts) const {
+    return chatAsync(singleTurn(userMessage), std::move(opts));
+}
+
+ChatHandle OpenAIClient::chatAsync(std::vector<ChatMessage> messages, ChatOptions opts) const {
+    ChatHandle h;
+    h.cancel_ = std::make_shared<std::atomic<bool>>(false);
+    const double timeout = opts.timeoutSeconds >= 0 ? opts.timeoutSeconds : m_timeoutSeconds;
+    auto cancel = h.cancel_;
+    h.future_ = std::async(std::launch::async, [this, messages = std::move(messages), opts = std::move(opts), cancel, timeout] {
+        ChatResult r = request(messages, opts.stream, opts.onDelta, cancel.get(), timeout);
+        if (opts.onDone) opts.onDone(r);
+        return r;
+    });
+    return h;
+}
+
+ChatResult OpenAIClient::request(const std::vector<ChatMessage>& messages, bool stream, const DeltaFn& onDelta,
+                                 const std::atomic<bool>* cancel, double timeoutSeconds) const {
+#ifdef HAVE_CURL
+    if (!m_offline) {
+        if (!m_conn || !m_conn->easy) {
+            return ChatResult{false, "", "curl_easy_init failed"};
+        }
+
+        const std::string payload_str = chatPayload(m_model, messages, stream);
+        const long timeoutMs = timeoutSeconds > 0 ? static_cast<long>(timeoutSeconds * 1000.0) : 0L;
+
+        std::string response;
+        SseStream s;
+        s.onDelta = &onDelta;
+        s.cancel = cancel;
+        s.start = std::chrono::steady_clock::now();
+        ChatResult r;
+        long code = 0;
+        CURLcode res = stream ? m_conn->perform(payload_str, true, sse_write_cb, &s, cancel, timeoutMs, code, r)
+                              : m_conn->perform(payload_str, false, write_cb, &response, cancel, timeoutMs, code, r);
+        if (stream && res == CURLE_OK && !s.pending.empty()) s.line(s.pending);   // last event without a trailing newline
+        r.firstTokenMs = s.firstTokenMs;
+        r.tokens = s.deltas;
+        if (s.usage.is_object()) applyUsage(s.usage, r);
+        const double genMs = s.lastTokenMs - s.firstTokenMs;
+        if (r.tokens > 1 && genMs > 0) r.tokensPerSec = (r.tokens - 1) * 1000.0 / genMs;
+
+        if (cancel && cancel->load() && res != CURLE_OK) {
+            r.cancelled = true;
+            r.text = s.text;   // what was delivered before the abort
+            r.error = "request cancelled";
+            return r;
+        }
+        if (res == CURLE_OPERATION_TIMEDOUT) {
+            r.timedOut = true;
+            r.text = s.text;
+            std::ostringstream msg;
+            msg << "no complete reply within " << timeoutSeconds << " s";
+            r.error = msg.str();
+            return r;
+        }
+        if (res != CURLE_OK) {
+            r.error = std::string("curl error: ") + curl_easy_strerror(res);
+            return r;
+        }
+
+        if (stream) {
+            if (code < 200 || code >= 300) {
+                r.text = s.raw;
+                r.error = httpError(code, s.raw);
+                return r;
+            }
+            if (!s.sawEvent) response = s.raw;   // servers that ignore "stream" send one ordinary completion
+            else if (!s.error.empty()) r.error = s.error;
+            else r.ok = true;
+            if (s.sawEvent) {
+                if (r.ok) r.text = s.text;
+                return r;
             }
-            return ChatResult{false, response, error_msg};
         }
 
-        if (j.contains("choices") && j["choices"].is_array() && !j["choices"].empty()) {
-            const auto& first_choice = j["choices"][0];
-            if (first_choice.contains("message") && first_choice["message"].is_object() && first_choice["message"].contains("content")) {
-                return ChatResult{true, first_choice["message"]["content"].get<std::string>(), ""};
+        r.text = response;
+        try {
+            nlohmann::json j = nlohmann::json::parse(response);
+            if (code < 200 || code >= 300) {
+                r.error = httpError(code, response);
+                return r;
+            }
+
+            if (j.contains("choices") && j["choices"].is_array() && !j["choices"].empty()) {
+                const auto& first_choice = j["choices"][0];
+                if (first_choice.contains("message") && first_choice["message"].is_object() && first_choice["message"].contains("content")) {
+                    r.ok = true;
+                    r.text = first_choice["message"]["content"].get<std::string>();
+                    if (stream) {
+                        s.deliver(r.text);
+                        r.firstTokenMs = s.firstTokenMs;
+                        r.tokens = 1;
+                    }
+                    if (j.contains("usage") && j["usage"].is_object()) applyUsage(j["usage"], r);
+                    return r;
+                }
             }
+        } catch (const nlohmann::json::parse_error& e) {
+            r.error = std::string("JSON parse error: ") + e.what();
+            return r;
         }
-    } catch (const nlohmann::json::parse_error& e) {
-        return ChatResult{false, response, std::string("JSON parse error: ") + e.what()};
-    }
 
-    // Fallback if structure is not as expected
-    return ChatResult{false, response, "Unexpected JSON structure from API"};
+        // Fallback if structure is not as expected
+        r.error = "Unexpected JSON structure from API";
+        return r;
+    }
+#else
+    (void)cancel;
+    (void)timeoutSeconds;
 #endif
+    // Offline echo mode; streamed as a single delta.
+    ChatResult r;
+    r.ok = true;
+    r.text = "(offline) Echo: " + (messages.empty() ? std::string() : messages.back().content);
+    if (stream) {
+        r.firstTokenMs = 0.0;
+        r.tokens = 1;
+        if (onDelta) onDelta(r.text);
+    }
+    return r;
 }
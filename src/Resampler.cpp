@@ -0,0 +1,452 @@
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <array>
+#include <utility>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define RESAMPLER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+
+// Sinc zero crossings on each side of the centre, at the output's bandwidth.
+constexpr int kZeroCrossings = 16;
+// Passband edge as a fraction of the lower Nyquist frequency.
+constexpr double kRolloff = 0.90;
+constexpr double kKaiserBeta = 8.0;
+// Above this many phases (odd rate pairs), phases are rounded instead of exact.
+constexpr int kMaxPhases = 512;
+
+// --- Compile-time filter design ---
+//
+// The rate pairs seen in practice (48k/44.1k capture -> 16k ASR, 16k/22.05k
+// Piper voices -> 48k output) get a kernel with the ratio and tap count baked
+// in. Same formulas as buildBank() below, in constexpr form.
+
+constexpr double kPi = 3.14159265358979323846;
+
+constexpr double cSin(double x) {
+    // Reduce to [-pi, pi], then Taylor; plenty for filter coefficients.
+    const double twoPi = 2.0 * kPi;
+    x -= twoPi * static_cast<double>(static_cast<long long>(x / twoPi));
+    if (x > kPi) x -= twoPi;
+    if (x < -kPi) x += twoPi;
+    double term = x, sum = x;
+    for (int k = 1; k < 14; ++k) {
+        term *= -x * x / ((2.0 * k) * (2.0 * k + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cSqrt(double x) {
+    if (x <= 0.0) return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 30; ++i) r = 0.5 * (r + x / r);
+    return r;
+}
+
+constexpr double cBesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cAbs(double x) { return x < 0.0 ? -x : x; }
+
+template<int Up, int Down>
+struct FixedShape {
+    static_assert(Up > 0 && Down > 0 && Up != Down, "not a conversion");
+    static constexpr int kPhases = Up;
+    static constexpr int kHalfWidth = (Up < Down) ? (kZeroCrossings * Down + Up - 1) / Up : kZeroCrossings;
+    static constexpr int kHistory = kHalfWidth - 1;
+    static constexpr int kTaps = (2 * kHalfWidth + 7) / 8 * 8;
+};
+
+// Coefficient table evaluated by the compiler. Only used for ratios with few
+// phases: the 160- and 320-phase banks would cost tens of seconds of
+// constexpr evaluation, so those kernels read the runtime-built bank instead.
+template<int Up, int Down>
+struct FixedBank : FixedShape<Up, Down> {
+    using S = FixedShape<Up, Down>;
+    static constexpr int kPhases = S::kPhases;
+    static constexpr int kTaps = S::kTaps;
+
+    static constexpr std::array<float, static_cast<size_t>(kPhases) * kTaps> design() {
+        std::array<float, static_cast<size_t>(kPhases) * kTaps> c{};
+        const double scale = (Up < Down) ? static_cast<double>(Up) / Down : 1.0;
+        const double fc = 0.5 * scale * kRolloff;
+        const double i0Beta = cBesselI0(kKaiserBeta);
+        for (int p = 0; p < kPhases; ++p) {
+            const double frac = static_cast<double>(p) / kPhases;
+            double tmp[kTaps] = {};
+            double sum = 0.0;
+            for (int k = 0; k < kTaps; ++k) {
+                const double d = (k - S::kHistory) - frac;
+                if (cAbs(d) >= S::kHalfWidth) continue;
+                const double x = 2.0 * fc * d;
+                const double sinc = (x == 0.0) ? 1.0 : cSin(kPi * x) / (kPi * x);
+                const double r = d / S::kHalfWidth;
+                const double w = cBesselI0(kKaiserBeta * cSqrt(1.0 - r * r)) / i0Beta;
+                tmp[k] = 2.0 * fc * sinc * w;
+                sum += tmp[k];
+            }
+            for (int k = 0; k < kTaps; ++k) {
+                c[static_cast<size_t>(p) * kTaps + k] = static_cast<float>(tmp[k] / sum);
+            }
+        }
+        return c;
+    }
+
+    static constexpr std::array<float, static_cast<size_t>(kPhases) * kTaps> kCoeffs = design();
+};
+
+// Inlined into the fixed-ratio kernels, where n is a compile-time constant.
+inline float dotKernel(const float* a, const float* b, size_t n) {
+#if defined(RESAMPLER_AVX2)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i < n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+#elif defined(RESAMPLER_SSE2)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 s = _mm_add_ps(acc0, acc1);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+    return _mm_cvtss_f32(s);
+#elif defined(RESAMPLER_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+#else
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (size_t i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+#endif
+}
+
+inline int16_t toPcm16(float v) {
+    v = std::max(-32768.0f, std::min(32767.0f, v));
+    return static_cast<int16_t>(std::lrint(v));
+}
+
+// Runs outputs from (idx, rem) until maxOut, or until the next output would
+// need input past bufEnd. buf holds absolute input samples from bufBase.
+size_t genericKernel(const PolyphaseBank& b, const float* buf, int64_t bufBase, int64_t bufEnd,
+                     int64_t& idx, uint64_t& rem, int16_t* out, size_t maxOut) {
+    size_t n = 0;
+    for (; n < maxOut; ++n) {
+        const int64_t first = idx - b.history;
+        if (first + b.taps > bufEnd) break;  // lookahead not received yet
+        const int p = (b.phases == b.up) ? static_cast<int>(rem)
+                                         : static_cast<int>(rem * b.phases / b.up);
+        out[n] = toPcm16(dotProduct(buf + (first - bufBase), b.phase(p), b.taps));
+        rem += b.down;
+        idx += static_cast<int64_t>(rem / b.up);
+        rem %= b.up;
+    }
+    return n;
+}
+
+// Same loop with the ratio and tap count known at compile time (and, for
+// small ratios, the coefficient table too): the dot product is fully
+// unrolled and the phase step needs no runtime division. For Up == 1 (3:1
+// decimation) it reduces to a plain FIR.
+template<int Up, int Down, bool ConstexprTable>
+size_t fixedKernel(const PolyphaseBank& b, const float* buf, int64_t bufBase, int64_t bufEnd,
+                   int64_t& idx, uint64_t& rem, int16_t* out, size_t maxOut) {
+    using S = FixedShape<Up, Down>;
+    const float* coeffs = b.coeffs.data();
+    if constexpr (ConstexprTable) coeffs = FixedBank<Up, Down>::kCoeffs.data();
+    size_t n = 0;
+    for (; n < maxOut; ++n) {
+        const int64_t first = idx - S::kHistory;
+        if (first + S::kTaps > bufEnd) break;
+        out[n] = toPcm16(dotKernel(buf + (first - bufBase), coeffs + rem * S::kTaps, S::kTaps));
+        rem += Down;
+        idx += static_cast<int64_t>(rem / Up);
+        rem %= Up;
+    }
+    return n;
+}
+
+struct FixedEntry {
+    int up, down;
+    const char* name;
+    StreamResampler::Kernel kernel;
+    const float* coeffs;
+    int taps, history;
+};
+
+template<int Up, int Down>
+constexpr FixedEntry tableEntry(const char* name) {
+    return { Up, Down, name, &fixedKernel<Up, Down, true>, FixedBank<Up, Down>::kCoeffs.data(),
+             FixedShape<Up, Down>::kTaps, FixedShape<Up, Down>::kHistory };
+}
+
+template<int Up, int Down>
+constexpr FixedEntry shapeEntry(const char* name) {
+    return { Up, Down, name, &fixedKernel<Up, Down, false>, nullptr,
+             FixedShape<Up, Down>::kTaps, FixedShape<Up, Down>::kHistory };
+}
+
+const FixedEntry kFixed[] = {
+    tableEntry<1, 3>("fixed 48000->16000 (3:1 FIR, constexpr taps)"),
+    tableEntry<3, 1>("fixed 16000->48000 (1:3, constexpr taps)"),
+    shapeEntry<160, 441>("fixed 44100->16000 (160/441)"),
+    shapeEntry<320, 147>("fixed 22050->48000 (320/147)"),
+};
+
+const FixedEntry* findFixed(int up, int down) {
+    for (const auto& e : kFixed) {
+        if (e.up == up && e.down == down) return &e;
+    }
+    return nullptr;
+}
+
+// Generic and fixed paths share one table, so they give identical output.
+bool copyFixedBank(PolyphaseBank& bank) {
+    const FixedEntry* e = findFixed(bank.up, bank.down);
+    if (!e || !e->coeffs) return false;
+    bank.phases = bank.up;
+    bank.taps = e->taps;
+    bank.history = e->history;
+    bank.coeffs.assign(e->coeffs, e->coeffs + static_cast<size_t>(bank.phases) * bank.taps);
+    return true;
+}
+
+double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+std::shared_ptr<PolyphaseBank> buildBank(int up, int down) {
+    auto bank = std::make_shared<PolyphaseBank>();
+    bank->up = up;
+    bank->down = down;
+    if (up == down) {
+        // Same rate: a single unit tap, so streams pass through unchanged.
+        bank->taps = 8;
+        bank->coeffs.assign(bank->taps, 0.0f);
+        bank->coeffs[0] = 1.0f;
+        return bank;
+    }
+    bank->phases = std::min(up, kMaxPhases);
+    if (copyFixedBank(*bank)) {
+        return bank;
+    }
+
+    // Cutoff in cycles per input sample; narrower when decimating.
+    const double scale = std::min(1.0, static_cast<double>(up) / down);
+    const double fc = 0.5 * scale * kRolloff;
+    const int halfWidth = static_cast<int>(std::ceil(kZeroCrossings / scale));
+    bank->history = halfWidth - 1;
+    bank->taps = (2 * halfWidth + 7) / 8 * 8;
+    bank->coeffs.assign(static_cast<size_t>(bank->phases) * bank->taps, 0.0f);
+
+    const double i0Beta = besselI0(kKaiserBeta);
+    for (int p = 0; p < bank->phases; ++p) {
+        const double frac = static_cast<double>(p) / bank->phases;
+        float* h = &bank->coeffs[static_cast<size_t>(p) * bank->taps];
+        double sum = 0.0;
+        std::vector<double> tmp(bank->taps, 0.0);
+        for (int k = 0; k < bank->taps; ++k) {
+            // Distance from the output instant to input sample k of the window.
+            const double d = (k - bank->history) - frac;
+            if (std::fabs(d) >= halfWidth) continue;
+            const double x = 2.0 * fc * d;
+            const double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            const double r = d / halfWidth;
+            const double w = besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / i0Beta;
+            tmp[k] = 2.0 * fc * sinc * w;
+            sum += tmp[k];
+        }
+        // Unity DC gain on every phase, so a constant input stays constant.
+        for (int k = 0; k < bank->taps; ++k) {
+            h[k] = static_cast<float>(sum != 0.0 ? tmp[k] / sum : 0.0);
+        }
+    }
+    return bank;
+}
+
+} // namespace
+
+std::shared_ptr<const PolyphaseBank> polyphaseBank(double rateIn, double rateOut) {
+    long in = std::max(1L, std::lround(rateIn));
+    long out = std::max(1L, std::lround(rateOut));
+    const long g = std::gcd(in, out);
+    const int up = static_cast<int>(out / g);
+    const int down = static_cast<int>(in / g);
+
+    static std::mutex mtx;
+    static std::map<std::pair<int, int>, std::shared_ptr<const PolyphaseBank>> banks;
+    std::lock_guard<std::mutex> lock(mtx);
+    auto& slot = banks[{up, down}];
+    if (!slot) {
+        slot = buildBank(up, down);
+    }
+    return slot;
+}
+
+float dotProduct(const float* a, const float* b, size_t n) {
+    return dotKernel(a, b, n);
+}
+
+const char* resamplerKernelName() {
+#if defined(RESAMPLER_AVX2)
+    return "avx2";
+#elif defined(RESAMPLER_SSE2)
+    return "sse2";
+#elif defined(RESAMPLER_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void StreamResampler::configure(double rateIn, double rateOut, ResamplerPath path) {
+    rateIn_ = rateIn;
+    rateOut_ = rateOut;
+    bank_ = polyphaseBank(rateIn, rateOut);
+    const FixedEntry* fixed = (path == ResamplerPath::Auto) ? findFixed(bank_->up, bank_->down) : nullptr;
+    kernel_ = fixed ? fixed->kernel : &genericKernel;
+    kernelName_ = fixed ? fixed->name : (bank_->up == bank_->down ? "passthrough" : "generic");
+    reset();
+}
+
+void StreamResampler::reset() {
+    if (!bank_) return;
+    // Start with `history` samples of silence before the first input sample.
+    buf_.assign(bank_->history, 0.0f);
+    bufBase_ = -static_cast<int64_t>(bank_->history);
+    inputSeen_ = 0;
+    outputDone_ = 0;
+    idx_ = 0;
+    rem_ = 0;
+}
+
+size_t StreamResampler::latencySamples() const {
+    return bank_ ? static_cast<size_t>(bank_->taps - bank_->history - 1) : 0;
+}
+
+size_t StreamResampler::pendingOutput(uint64_t inputEnd) const {
+    const uint64_t total = inputEnd * bank_->up / bank_->down;
+    return total > outputDone_ ? static_cast<size_t>(total - outputDone_) : 0;
+}
+
+size_t StreamResampler::maxOutput(size_t inSamples) const {
+    return bank_ ? pendingOutput(inputSeen_ + inSamples) : 0;
+}
+
+size_t StreamResampler::produce(int16_t* out, size_t outCapacity, uint64_t limit) {
+    const PolyphaseBank& b = *bank_;
+    const int64_t bufEnd = bufBase_ + static_cast<int64_t>(buf_.size());
+    const size_t maxOut = static_cast<size_t>(std::min<uint64_t>(outCapacity, limit > outputDone_ ? limit - outputDone_ : 0));
+    const size_t written = kernel_(b, buf_.data(), bufBase_, bufEnd, idx_, rem_, out, maxOut);
+    outputDone_ += written;
+    // Drop input that no future output can reach.
+    const int64_t keepFrom = std::min(idx_ - b.history, bufEnd);
+    if (keepFrom > bufBase_) {
+        buf_.erase(buf_.begin(), buf_.begin() + static_cast<size_t>(keepFrom - bufBase_));
+        bufBase_ = keepFrom;
+    }
+    return written;
+}
+
+size_t StreamResampler::process(const int16_t* in, size_t inSamples, int16_t* out, size_t outCapacity) {
+    if (!bank_) return 0;
+    const size_t old = buf_.size();
+    buf_.resize(old + inSamples);
+    float* dst = buf_.data() + old;
+    for (size_t i = 0; i < inSamples; ++i) dst[i] = in[i];
+    inputSeen_ += inSamples;
+    return produce(out, outCapacity, inputSeen_ * bank_->up / bank_->down);
+}
+
+void StreamResampler::process(const int16_t* in, size_t inSamples, std::vector<int16_t>& out) {
+    const size_t start = out.size();
+    out.resize(start + maxOutput(inSamples));
+    out.resize(start + process(in, inSamples, out.data() + start, out.size() - start));
+}
+
+size_t StreamResampler::flush(int16_t* out, size_t outCapacity) {
+    if (!bank_) return 0;
+    const uint64_t limit = inputSeen_ * bank_->up / bank_->down;
+    // Pad with silence so the last outputs have their full lookahead.
+    const int64_t needEnd = idx_ - bank_->history + bank_->taps
+                          + static_cast<int64_t>(pendingOutput(inputSeen_)) * bank_->down / bank_->up + 1;
+    const int64_t bufEnd = bufBase_ + static_cast<int64_t>(buf_.size());
+    if (needEnd > bufEnd) buf_.resize(buf_.size() + static_cast<size_t>(needEnd - bufEnd), 0.0f);
+    size_t written = produce(out, outCapacity, limit);
+    if (outputDone_ >= limit) reset();
+    return written;
+}
+
+void StreamResampler::flush(std::vector<int16_t>& out) {
+    const size_t start = out.size();
+    out.resize(start + maxOutput(0));
+    out.resize(start + flush(out.data() + start, out.size() - start));
+}
+
+std::vector<int16_t> resamplePcm(const int16_t* pcm, size_t samples, double rateIn, double rateOut) {
+    if (samples == 0 || rateIn <= 0 || rateOut <= 0) return {};
+    if (std::lround(rateIn) == std::lround(rateOut)) {
+        return std::vector<int16_t>(pcm, pcm + samples);
+    }
+    StreamResampler rs(rateIn, rateOut);
+    std::vector<int16_t> out;
+    out.reserve(rs.maxOutput(samples));
+    rs.process(pcm, samples, out);
+    rs.flush(out);
+    return out;
+}
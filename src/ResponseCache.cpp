@@ -0,0 +1,221 @@
+#include "ResponseCache.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include "nlohmann/json.hpp"
+#if __has_include(<filesystem>)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
+
+namespace {
+const int kVersion = 2;
+
+uint64_t fnv1a(const std::string& s) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Letters, digits and any UTF-8 byte count as part of a word; an
+// apostrophe does not, so "l'heure" contains "heure".
+bool wordChar(char c) {
+    const unsigned char u = static_cast<unsigned char>(c);
+    return u >= 0x80 || std::isalnum(u);
+}
+
+bool containsWord(const std::string& text, const std::string& word) {
+    if (word.empty()) return false;
+    for (size_t pos = text.find(word); pos != std::string::npos; pos = text.find(word, pos + 1)) {
+        const size_t end = pos + word.size();
+        if ((pos == 0 || !wordChar(text[pos - 1])) && (end == text.size() || !wordChar(text[end]))) return true;
+    }
+    return false;
+}
+
+size_t entryBytes(const std::string& question, const std::string& reply) {
+    return question.size() + reply.size();
+}
+}
+
+std::string normalizeQuestion(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (std::isspace(c) || (std::ispunct(c) && c != '\'' && c != '-')) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        if (text.compare(i, 3, "\xE2\x80\x99") == 0) {   // U+2019 right single quote
+            out += '\'';
+            i += 2;
+        } else {
+            out += static_cast<char>(std::tolower(c));
+        }
+    }
+    return out;
+}
+
+ResponseCache::ResponseCache(const std::string& model, const std::string& systemPrompt, const ResponseCacheConfig& cfg)
+    : cfg_(cfg), scope_(model + '\n' + systemPrompt + '\n') {
+    load();
+}
+
+int ResponseCache::ttlFor(const std::string& normalized) const {
+    for (const auto& rule : cfg_.rules) {
+        if (containsWord(normalized, normalizeQuestion(rule.keyword))) return rule.ttlSeconds;
+    }
+    return cfg_.ttlSeconds;
+}
+
+uint64_t ResponseCache::keyFor(const std::string& normalized, uint64_t context) const {
+    return fnv1a(scope_ + std::to_string(context) + '\n' + normalized);
+}
+
+bool ResponseCache::cacheable(const std::string& question) const {
+    const std::string norm = normalizeQuestion(question);
+    return !norm.empty() && ttlFor(norm) > 0;
+}
+
+// Caller holds mutex_.
+void ResponseCache::erase(std::list<Entry>::iterator it) {
+    stats_.bytes -= entryBytes(it->question, it->reply);
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+// Caller holds mutex_.
+void ResponseCache::insert(Entry e) {
+    const size_t bytes = entryBytes(e.question, e.reply);
+    if (bytes > cfg_.maxBytes || cfg_.maxEntries == 0) return;
+    auto it = index_.find(e.key);
+    if (it != index_.end()) erase(it->second);
+    while (!lru_.empty() && (lru_.size() >= cfg_.maxEntries || stats_.bytes + bytes > cfg_.maxBytes)) {
+        erase(std::prev(lru_.end()));
+        ++stats_.evictions;
+    }
+    lru_.push_front(std::move(e));
+    index_[lru_.front().key] = lru_.begin();
+    stats_.bytes += bytes;
+}
+
+bool ResponseCache::lookup(const std::string& question, const std::string& context, std::string& reply) {
+    const std::string norm = normalizeQuestion(question);
+    const uint64_t ctx = context.empty() ? 0 : fnv1a(context);
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (norm.empty() || ttlFor(norm) <= 0) {
+        ++stats_.bypassed;
+        return false;
+    }
+    auto it = index_.find(keyFor(norm, ctx));
+    if (it == index_.end() || it->second->question != norm || it->second->context != ctx) {
+        ++stats_.misses;
+        return false;
+    }
+    if (it->second->expires <= nowSeconds()) {
+        erase(it->second);
+        ++stats_.expired;
+        ++stats_.misses;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    reply = lru_.front().reply;
+    ++stats_.hits;
+    return true;
+}
+
+void ResponseCache::store(const std::string& question, const std::string& context, const std::string& reply) {
+    const std::string norm = normalizeQuestion(question);
+    if (norm.empty() || reply.empty()) return;
+    const int ttl = ttlFor(norm);
+    if (ttl <= 0) return;
+    std::lock_guard<std::mutex> lk(mutex_);
+    const uint64_t ctx = context.empty() ? 0 : fnv1a(context);
+    insert(Entry{keyFor(norm, ctx), norm, ctx, reply, nowSeconds() + ttl});
+    save();
+}
+
+// Entries of another model or system prompt hash to other keys and are dropped.
+void ResponseCache::load() {
+    if (cfg_.path.empty()) return;
+    std::ifstream f(cfg_.path);
+    if (!f) return;
+    nlohmann::json j = nlohmann::json::parse(f, nullptr, false);
+    if (j.is_discarded() || !j.is_object() || j.value("version", 0) != kVersion || !j["entries"].is_array()) {
+        std::cerr << "[llm] Ignoring unreadable response cache " << cfg_.path << std::endl;
+        return;
+    }
+    const int64_t now = nowSeconds();
+    const auto& entries = j["entries"];
+    // Saved most recent first: insert oldest first to restore the LRU order.
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        if (!it->is_object()) continue;
+        Entry e;
+        e.question = it->value("question", std::string());
+        e.reply = it->value("reply", std::string());
+        e.context = std::strtoull(it->value("context", std::string("0")).c_str(), nullptr, 10);
+        e.expires = it->value("expires", int64_t(0));
+        if (e.question.empty() || e.reply.empty() || e.expires <= now) continue;
+        e.key = keyFor(e.question, e.context);
+        if (it->value("key", std::string()) != std::to_string(e.key)) continue;
+        insert(std::move(e));
+    }
+}
+
+// Caller holds mutex_. Atomic: write tmp + rename.
+void ResponseCache::save() const {
+    if (cfg_.path.empty()) return;
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto& e : lru_) {
+        entries.push_back({{"key", std::to_string(e.key)}, {"question", e.question},
+                           {"context", std::to_string(e.context)}, {"reply", e.reply}, {"expires", e.expires}});
+    }
+    nlohmann::json j = {{"version", kVersion}, {"entries", entries}};
+
+    std::error_code ec;
+    const std::filesystem::path path(cfg_.path);
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+    const std::string tmp = cfg_.path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        if (!f) return;
+        f << j.dump();
+        if (!f) return;
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+}
+
+ResponseCacheStats ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    ResponseCacheStats s = stats_;
+    s.entries = lru_.size();
+    return s;
+}
+
+std::string ResponseCache::statsLine() const {
+    ResponseCacheStats s = stats();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "[llm] Response cache: " << s.hits << " hits, " << s.misses << " misses, hit rate "
+        << 100.0 * s.hitRate() << "%, " << s.bypassed << " bypassed, " << s.entries << " entries";
+    return out.str();
+}
@@ -0,0 +1,252 @@
+#include "TtsCache.h"
+#include "Utils.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cctype>
+#if __has_include(<filesystem>)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
+
+namespace {
+const char kMagic[4] = {'T', 'T', 'S', 'C'};
+const uint32_t kVersion = 1;
+
+uint64_t fnv1a(const std::string& s) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+size_t entryBytes(size_t samples) {
+    return samples * sizeof(int16_t);
+}
+}
+
+std::string normalizeTtsText(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+        if (std::isspace(c)) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        if (text.compare(i, 3, "\xE2\x80\x99") == 0) {   // U+2019 right single quote
+            out += '\'';
+            i += 2;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+TtsCache::TtsCache(std::unique_ptr<TtsEngine> engine, const TtsCacheConfig& cfg)
+    : engine_(std::move(engine)), cfg_(cfg) {
+    voiceKey_ = engine_->voiceKey();
+    if (cfg_.dir.empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(cfg_.dir, ec);
+    for (std::filesystem::directory_iterator it(cfg_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".pcm") stats_.diskBytes += it->file_size(ec);
+    }
+}
+
+void TtsCache::setOutputRate(double rate) {
+    engine_->setOutputRate(rate);
+    std::lock_guard<std::mutex> lk(mutex_);
+    outputRate_ = rate;
+    voiceKey_ = engine_->voiceKey();
+}
+
+std::string TtsCache::pathFor(uint64_t key) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".pcm";
+    return (std::filesystem::path(cfg_.dir) / name.str()).string();
+}
+
+// Caller holds mutex_.
+bool TtsCache::lookup(uint64_t key, const std::string& id, std::vector<int16_t>& pcm, double& rate) {
+    auto it = index_.find(key);
+    if (it != index_.end() && it->second->id == id) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        pcm = it->second->pcm;
+        rate = it->second->rate;
+        ++stats_.memoryHits;
+        return true;
+    }
+    if (cfg_.dir.empty()) return false;
+
+    const std::string path = pathFor(key);
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0, fileRate = 0, idLen = 0;
+    f.read(magic, 4);
+    f.read(reinterpret_cast<char*>(&version), sizeof(version));
+    f.read(reinterpret_cast<char*>(&fileRate), sizeof(fileRate));
+    f.read(reinterpret_cast<char*>(&idLen), sizeof(idLen));
+    if (!f || std::memcmp(magic, kMagic, 4) != 0 || version != kVersion || idLen != id.size()) return false;
+    std::string fileId(idLen, '\0');
+    f.read(&fileId[0], idLen);
+    if (!f || fileId != id) return false;
+    const std::streampos body = f.tellg();
+    f.seekg(0, std::ios::end);
+    const size_t samples = static_cast<size_t>(f.tellg() - body) / sizeof(int16_t);
+    f.seekg(body);
+    pcm.resize(samples);
+    f.read(reinterpret_cast<char*>(pcm.data()), entryBytes(samples));
+    if (!f || samples == 0) return false;
+    rate = fileRate;
+    ++stats_.diskHits;
+
+    // Recently used files survive pruning longest.
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    insertMemory(key, id, pcm, rate);
+    return true;
+}
+
+// Caller holds mutex_.
+void TtsCache::insertMemory(uint64_t key, const std::string& id, const std::vector<int16_t>& pcm, double rate) {
+    const size_t bytes = entryBytes(pcm.size());
+    if (bytes > cfg_.memoryBytes) return;
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        stats_.memoryBytes -= entryBytes(it->second->pcm.size());
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    while (!lru_.empty() && stats_.memoryBytes + bytes > cfg_.memoryBytes) {
+        stats_.memoryBytes -= entryBytes(lru_.back().pcm.size());
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+    lru_.push_front(Entry{key, id, pcm, rate});
+    index_[key] = lru_.begin();
+    stats_.memoryBytes += bytes;
+}
+
+// Caller holds mutex_.
+void TtsCache::storeDisk(uint64_t key, const std::string& id, const std::vector<int16_t>& pcm, double rate) {
+    if (cfg_.dir.empty()) return;
+    const std::string path = pathFor(key);
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return;
+        const uint32_t version = kVersion;
+        const uint32_t fileRate = static_cast<uint32_t>(rate);
+        const uint32_t idLen = static_cast<uint32_t>(id.size());
+        f.write(kMagic, 4);
+        f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        f.write(reinterpret_cast<const char*>(&fileRate), sizeof(fileRate));
+        f.write(reinterpret_cast<const char*>(&idLen), sizeof(idLen));
+        f.write(id.data(), idLen);
+        f.write(reinterpret_cast<const char*>(pcm.data()), entryBytes(pcm.size()));
+        if (!f) return;
+    }
+    std::error_code ec;
+    const uintmax_t old = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return;
+    }
+    stats_.diskBytes += std::filesystem::file_size(path, ec);
+    stats_.diskBytes -= std::min<size_t>(stats_.diskBytes, old);
+    if (stats_.diskBytes > cfg_.diskBytes) pruneDisk();
+}
+
+// Caller holds mutex_. Deletes the least recently used files down to 90% of the limit.
+void TtsCache::pruneDisk() {
+    namespace fs = std::filesystem;
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    std::error_code ec;
+    for (fs::directory_iterator it(cfg_.dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".pcm") files.emplace_back(fs::last_write_time(it->path(), ec), it->path());
+    }
+    std::sort(files.begin(), files.end());
+    const size_t target = cfg_.diskBytes / 10 * 9;
+    for (const auto& f : files) {
+        if (stats_.diskBytes <= target) break;
+        const uintmax_t size = fs::file_size(f.second, ec);
+        if (!ec && fs::remove(f.second, ec)) stats_.diskBytes -= std::min<size_t>(stats_.diskBytes, size);
+    }
+}
+
+std::vector<int16_t> TtsCache::synthesize(const std::string& text, double& sampleRate) {
+    const std::string norm = normalizeTtsText(text);
+    if (norm.empty()) return engine_->synthesize(text, sampleRate);
+
+    std::string id;
+    uint64_t key = 0;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        id = voiceKey_ + '\n' + norm;
+        key = fnv1a(id);
+        std::vector<int16_t> pcm;
+        double rate = 0.0;
+        if (lookup(key, id, pcm, rate)) {
+            sampleRate = rate;
+            return pcm;
+        }
+        ++stats_.misses;
+    }
+
+    double rate = 0.0;
+    std::vector<int16_t> pcm = engine_->synthesize(norm, rate);
+    if (pcm.empty()) return pcm;
+    sampleRate = rate;
+    std::lock_guard<std::mutex> lk(mutex_);
+    insertMemory(key, id, pcm, rate);
+    storeDisk(key, id, pcm, rate);
+    return pcm;
+}
+
+size_t TtsCache::prewarm(const std::vector<std::string>& phrases) {
+    auto t0 = std::chrono::steady_clock::now();
+    const uint64_t missesBefore = stats().misses;
+    for (const auto& phrase : phrases) {
+        double rate = 0.0;
+        synthesize(phrase, rate);
+    }
+    const size_t synthesized = static_cast<size_t>(stats().misses - missesBefore);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[tts] Cache pre-warmed " << phrases.size() << " phrases (" << synthesized
+              << " synthesized) in " << static_cast<int>(ms) << " ms" << std::endl;
+    return synthesized;
+}
+
+TtsCacheStats TtsCache::stats() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    TtsCacheStats s = stats_;
+    s.memoryEntries = lru_.size();
+    return s;
+}
+
+std::string TtsCache::statsLine() const {
+    TtsCacheStats s = stats();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1)
+        << "[tts] Cache: " << s.hits() << " hits (" << s.memoryHits << " memory, " << s.diskHits << " disk), "
+        << s.misses << " misses, hit rate " << 100.0 * s.hitRate() << "%, "
+        << s.memoryEntries << " entries / " << s.memoryBytes / 1048576.0 << " MB in memory, "
+        << s.diskBytes / 1048576.0 << " MB on disk";
+    return out.str();
+}
@@ -0,0 +1,197 @@
+#include "TtsPipeline.h"
+#include "TtsEngine.h"
+#include "Utils.h"
+#include <cctype>
+
+namespace {
+// Sentences longer than this are also cut after commas, semicolons and colons.
+constexpr size_t kClauseChars = 60;
+
+bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+}
+
+size_t takeSpeechChunks(std::string& buffer, std::vector<std::string>& chunks, bool final) {
+    const size_t before = chunks.size();
+    size_t start = 0;
+    auto emit = [&](size_t end) {
+        std::string chunk = trim(buffer.substr(start, end - start));
+        if (!chunk.empty()) chunks.push_back(std::move(chunk));
+        start = end;
+    };
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        const char c = buffer[i];
+        size_t end = 0;   // one past the boundary's punctuation
+        bool sentence = false;
+        if (c == '.' || c == '!' || c == '?' || c == '\n') {
+            end = i + 1;
+            sentence = true;
+        } else if (buffer.compare(i, 3, "\xE2\x80\xA6") == 0) {   // U+2026 ellipsis
+            end = i + 3;
+            sentence = true;
+        } else if (c == ',' || c == ';' || c == ':') {
+            end = i + 1;
+        } else {
+            continue;
+        }
+        // Collapse "?!", "..." etc. into one boundary.
+        while (end < buffer.size() && (buffer[end] == '.' || buffer[end] == '!' || buffer[end] == '?')) ++end;
+        if (end >= buffer.size()) break;                  // next character still unknown
+        if (!isSpace(buffer[end])) { i = end - 1; continue; }   // "3.5", "a,b"
+        if (!sentence && end - start < kClauseChars) { i = end - 1; continue; }
+        emit(end);
+        i = end - 1;
+    }
+    if (final) emit(buffer.size());
+    buffer.erase(0, start);
+    return chunks.size() - before;
+}
+
+std::vector<std::string> splitForSpeech(const std::string& text) {
+    std::string buffer = text;
+    std::vector<std::string> chunks;
+    takeSpeechChunks(buffer, chunks, true);
+    return chunks;
+}
+
+TtsPipeline::TtsPipeline(TtsEngine& tts, Sink sink)
+    : tts_(tts), sink_(std::move(sink)) {
+    worker_ = std::thread(&TtsPipeline::run, this);
+}
+
+TtsPipeline::~TtsPipeline() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+        queue_.clear();
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void TtsPipeline::begin() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    ++generation_;
+    queue_.clear();
+    text_.clear();
+    ended_ = false;
+    pendingMore_ = false;
+    stats_ = TtsPipelineStats();
+    audio_.clear();
+    sampleRate_ = 0.0;
+    lastError_.clear();
+    start_ = std::chrono::steady_clock::now();
+}
+
+void TtsPipeline::push(const std::string& text) {
+    std::vector<std::string> chunks;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (ended_) return;
+        text_ += text;
+        takeSpeechChunks(text_, chunks, false);
+        for (auto& c : chunks) queue_.push_back(std::move(c));
+    }
+    if (!chunks.empty()) wake_.notify_all();
+}
+
+void TtsPipeline::end() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (ended_) return;
+        std::vector<std::string> chunks;
+        takeSpeechChunks(text_, chunks, true);
+        for (auto& c : chunks) queue_.push_back(std::move(c));
+        ended_ = true;
+    }
+    wake_.notify_all();
+}
+
+TtsPipelineStats TtsPipeline::wait() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    done_.wait(lk, [this]{ return idleLocked() || stop_; });
+    return stats_;
+}
+
+void TtsPipeline::cancel() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    ++generation_;
+    queue_.clear();
+    text_.clear();
+    ended_ = true;
+    pendingMore_ = false;
+    // The chunk in the engine is dropped when it comes back.
+    done_.wait(lk, [this]{ return !busy_ || stop_; });
+}
+
+std::string TtsPipeline::lastError() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return lastError_;
+}
+
+void TtsPipeline::run() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        wake_.wait(lk, [this]{ return stop_ || !queue_.empty() || (ended_ && pendingMore_); });
+        if (stop_) return;
+        const uint64_t generation = generation_;
+
+        if (queue_.empty()) {
+            // The reply ended after its last chunk went out with more=true.
+            pendingMore_ = false;
+            busy_ = true;
+            const double rate = sampleRate_;
+            lk.unlock();
+            sink_(std::vector<int16_t>(), rate, false);
+            lk.lock();
+            busy_ = false;
+            done_.notify_all();
+            continue;
+        }
+
+        std::string text = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lk.unlock();
+        auto t0 = std::chrono::steady_clock::now();
+        double rate = 0.0;
+        std::vector<int16_t> pcm = tts_.synthesize(text, rate);
+        const double synthMs = msSince(t0);
+        lk.lock();
+
+        if (generation == generation_) {
+            stats_.synthMs += synthMs;
+            if (pcm.empty()) {
+                ++stats_.failed;
+                lastError_ = tts_.lastError();
+            } else {
+                const bool more = !queue_.empty() || !ended_;
+                if (stats_.firstAudioMs < 0) stats_.firstAudioMs = msSince(start_);
+                sampleRate_ = rate;
+                if (keepAudio_) audio_.insert(audio_.end(), pcm.begin(), pcm.end());
+                lk.unlock();
+                const bool accepted = sink_(pcm, rate, more);
+                lk.lock();
+                if (generation == generation_) {
+                    ++stats_.chunks;
+                    stats_.audioSeconds += rate > 0 ? pcm.size() / rate : 0.0;
+                    stats_.totalMs = msSince(start_);
+                    pendingMore_ = more;
+                    if (!accepted) {
+                        queue_.clear();
+                        text_.clear();
+                        ended_ = true;
+                        pendingMore_ = false;
+                    }
+                }
+            }
+        }
+        busy_ = false;
+        done_.notify_all();
+    }
+}
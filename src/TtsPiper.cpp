@@ -1,99 +1,264 @@
 #include "TtsPiper.h"
 #include "Utils.h"
+#include "Resampler.h"
 #include <iostream>
 #include <fstream>
-#include <stdexcept>
 #include <cstdio>
 #include <cstdlib>
-#include <filesystem>
-
-#include "dr_wav.h"
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include "nlohmann/json.hpp"
 
 #ifdef WITH_PIPER
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+// Longest wait for any output from piper before the worker is considered hung.
+const int kStallMs = 30000;
 
-// Helper to check if a file exists
-static bool fileExists(const std::string& path) {
-    // This check is basic. A more robust check would handle permissions.
-    std::ifstream f(path.c_str());
-    return f.good();
+bool isExecutable(const std::string& path) {
+    return access(path.c_str(), X_OK) == 0;
 }
 
-TtsPiper::TtsPiper(const std::string& modelPath, const std::string& piperBin)
-    : bin_(piperBin), model_(modelPath) {}
+// Finds the binary like execvp() would, once, instead of running `which`
+// through a shell on every call.
+std::string resolveBinary(const std::string& bin) {
+    if (bin.empty()) return "";
+    if (bin.find('/') != std::string::npos) return isExecutable(bin) ? bin : "";
+    const char* path = std::getenv("PATH");
+    std::string dirs = path ? path : "/usr/local/bin:/usr/bin:/bin";
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        std::string dir = dirs.substr(start, end - start);
+        std::string candidate = (dir.empty() ? "." : dir) + "/" + bin;
+        if (isExecutable(candidate)) return candidate;
+        start = end + 1;
+    }
+    return "";
+}
 
-bool TtsPiper::isAvailable() const {
-    if (model_.empty() || !fileExists(model_)) {
-        lastErr_ = "Model file not found or is not accessible: " + model_;
-        return false;
+// Piper writes the voice's config next to the model as <model>.json.
+double readVoiceRate(const std::string& model, double fallback) {
+    std::ifstream f(model + ".json");
+    if (!f) return fallback;
+    try {
+        nlohmann::json j = nlohmann::json::parse(f);
+        return j.at("audio").at("sample_rate").get<double>();
+    } catch (const std::exception&) {
+        return fallback;
     }
+}
 
-    // Check if bin_ is a direct path or can be found in PATH
-    std::string command = "which " + bin_ + " > /dev/null 2>&1";
-    if (system(command.c_str()) != 0) {
-        if (!fileExists(bin_)) {
-            lastErr_ = "Piper binary not found or not executable: " + bin_;
+bool writeAll(int fd, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = write(fd, data.data() + off, data.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
             return false;
         }
+        off += static_cast<size_t>(n);
     }
     return true;
 }
 
-std::vector<int16_t> TtsPiper::synthesize(const std::string& text, double& sampleRate) {
-    if (!isAvailable()) {
-        // lastErr_ is already set by isAvailable()
-        return {};
+void closeFd(int& fd) {
+    if (fd >= 0) close(fd);
+    fd = -1;
+}
+}
+
+TtsPiper::TtsPiper(const std::string& modelPath, const std::string& piperBin)
+    : bin_(piperBin.empty() ? "piper" : piperBin), model_(modelPath) {
+    std::ifstream f(model_.c_str());
+    if (model_.empty() || !f.good()) {
+        lastErr_ = "Model file not found or is not accessible: " + model_;
+        return;
     }
+    bin_ = resolveBinary(bin_);
+    if (bin_.empty()) {
+        lastErr_ = "Piper binary not found or not executable: " + piperBin;
+        return;
+    }
+    voiceRate_ = readVoiceRate(model_, voiceRate_);
+    available_ = true;
+
+    // Start now so the voice loads while the rest of the app starts up.
+    std::lock_guard<std::mutex> lk(mutex_);
+    startWorker();
+}
+
+TtsPiper::~TtsPiper() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stopWorker();
+}
 
-    std::filesystem::path tmpDir = "captures";
-    std::filesystem::create_directories(tmpDir);
-    std::string tmpWav = (tmpDir / "tts_tmp.wav").string();
+bool TtsPiper::isAvailable() const {
+    return available_;
+}
 
-    // Escape double quotes in the text to prevent breaking the command
-    std::string sanitized_text = text;
-    size_t pos = 0;
-    while ((pos = sanitized_text.find('"', pos)) != std::string::npos) {
-        sanitized_text.replace(pos, 1, "\\\"");
-        pos += 2;
+bool TtsPiper::startWorker() {
+    // A write to a worker that just died must fail with EPIPE, not kill us.
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int in[2], out[2], err[2];
+    if (pipe2(in, O_CLOEXEC) != 0) {
+        lastErr_ = "Could not create pipes for the Piper worker";
+        return false;
+    }
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        close(in[0]); close(in[1]);
+        lastErr_ = "Could not create pipes for the Piper worker";
+        return false;
+    }
+    if (pipe2(err, O_CLOEXEC) != 0) {
+        close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+        lastErr_ = "Could not create pipes for the Piper worker";
+        return false;
     }
 
-    std::string command = bin_ + " --model " + model_ + " --output_file " + tmpWav + " --text \"" + sanitized_text + "\"";
+    // Built before fork(): the child may only make async-signal-safe calls.
+    std::vector<std::string> args = {bin_, "--model", model_, "--json-input", "--output_raw"};
+    std::vector<char*> argv;
+    for (auto& a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
 
-    int ret = system(command.c_str());
-    if (ret != 0) {
-        lastErr_ = "Piper command failed with exit code " + std::to_string(ret);
-        remove(tmpWav.c_str());
-        return {};
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(in[0]); close(in[1]); close(out[0]); close(out[1]); close(err[0]); close(err[1]);
+        lastErr_ = "Could not start the Piper worker";
+        return false;
+    }
+    if (pid == 0) {
+        dup2(in[0], STDIN_FILENO);
+        dup2(out[1], STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    close(in[0]);
+    close(out[1]);
+    close(err[1]);
+    pid_ = static_cast<int>(pid);
+    stdin_ = in[1];
+    stdout_ = out[0];
+    stderr_ = err[0];
+    stderrLine_.clear();
+    std::cout << "[tts] Piper worker started (pid " << pid_ << ", voice at " << voiceRate_ << " Hz)" << std::endl;
+    return true;
+}
+
+void TtsPiper::stopWorker() {
+    if (pid_ < 0) return;
+    // EOF on stdin makes piper exit on its own; give it a moment first.
+    closeFd(stdin_);
+    int status = 0;
+    bool exited = false;
+    for (int i = 0; i < 50 && !exited; ++i) {
+        exited = waitpid(pid_, &status, WNOHANG) == pid_;
+        if (!exited) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!exited) {
+        kill(pid_, SIGKILL);
+        waitpid(pid_, &status, 0);
     }
+    closeFd(stdout_);
+    closeFd(stderr_);
+    pid_ = -1;
+}
 
-    unsigned int channels;
-    unsigned int sr;
-    drwav_uint64 totalPcmFrameCount;
-    int16_t* pcmData = drwav_open_file_and_read_pcm_frames_s16(tmpWav.c_str(), &channels, &sr, &totalPcmFrameCount, nullptr);
+bool TtsPiper::readUtterance(std::vector<int16_t>& pcm) {
+    std::string bytes;
+    char buf[16384];
+    bool done = false;
+    for (;;) {
+        pollfd fds[2] = {{stdout_, POLLIN, 0}, {stderr_, POLLIN, 0}};
+        // Once the end-of-utterance line is in, only drain what is already
+        // in the pipe: piper flushes the audio before logging that line.
+        int n = poll(fds, 2, done ? 0 : kStallMs);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            lastErr_ = "poll() failed on the Piper worker";
+            return false;
+        }
+        if (n == 0) {
+            if (done) break;
+            lastErr_ = "Piper worker produced no output for " + std::to_string(kStallMs / 1000) + " s";
+            return false;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t r = read(stdout_, buf, sizeof(buf));
+            if (r == 0) {
+                lastErr_ = "Piper worker exited";
+                return false;
+            }
+            if (r > 0) bytes.append(buf, static_cast<size_t>(r));
+        } else if (done) {
+            break;
+        }
+        if (!done && (fds[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t r = read(stderr_, buf, sizeof(buf));
+            if (r == 0) {
+                lastErr_ = "Piper worker exited";
+                return false;
+            }
+            if (r > 0) stderrLine_.append(buf, static_cast<size_t>(r));
+            size_t eol;
+            while ((eol = stderrLine_.find('\n')) != std::string::npos) {
+                std::string line = trim(stderrLine_.substr(0, eol));
+                stderrLine_.erase(0, eol + 1);
+                if (line.find("Real-time factor") != std::string::npos) {
+                    done = true;
+                } else if (line.find("Loaded voice") != std::string::npos
+                           || line.find("error") != std::string::npos
+                           || line.find("warn") != std::string::npos) {
+                    std::cerr << "[tts] piper: " << line << std::endl;
+                }
+            }
+        }
+    }
+    pcm.resize(bytes.size() / sizeof(int16_t));
+    if (!pcm.empty()) std::memcpy(pcm.data(), bytes.data(), pcm.size() * sizeof(int16_t));
+    return true;
+}
 
-    if (pcmData == nullptr) {
-        lastErr_ = "Failed to read or decode WAV file: " + tmpWav;
-        remove(tmpWav.c_str());
+std::vector<int16_t> TtsPiper::synthesize(const std::string& text, double& sampleRate) {
+    if (!available_) {
         return {};
     }
+    // One JSON object per line; dump() escapes any newline in the text.
+    std::string request = nlohmann::json{{"text", text}}.dump() + "\n";
 
+    std::lock_guard<std::mutex> lk(mutex_);
     std::vector<int16_t> audioBuffer;
-    if (channels > 1) {
-        audioBuffer.resize(totalPcmFrameCount);
-        for (drwav_uint64 i = 0; i < totalPcmFrameCount; ++i) {
-            int32_t sample_sum = 0;
-            for (unsigned int j = 0; j < channels; ++j) {
-                sample_sum += pcmData[i * channels + j];
-            }
-            audioBuffer[i] = static_cast<int16_t>(sample_sum / channels);
+    lastErr_.clear();
+    for (;;) {
+        // A worker kept from an earlier call may have died since; that one
+        // gets a single retry on a fresh process.
+        const bool reused = pid_ >= 0;
+        if (!reused && !startWorker()) return {};
+        if (!writeAll(stdin_, request)) {
+            lastErr_ = "Could not write to the Piper worker";
+        } else if (readUtterance(audioBuffer)) {
+            break;
         }
-    } else {
-        audioBuffer.assign(pcmData, pcmData + totalPcmFrameCount);
+        stopWorker();
+        if (!reused) return {};
     }
 
-    drwav_free(pcmData, nullptr);
-    remove(tmpWav.c_str());
-
-    sampleRate = static_cast<double>(sr);
+    sampleRate = voiceRate_;
+    if (outputRate_ > 0 && outputRate_ != sampleRate) {
+        audioBuffer = resamplePcm(audioBuffer.data(), audioBuffer.size(), sampleRate, outputRate_);
+        sampleRate = outputRate_;
+    }
     lastErr_ = "";
     return audioBuffer;
 }
@@ -102,12 +267,21 @@ const std::string& TtsPiper::lastError() const {
     return lastErr_;
 }
 
+std::string TtsPiper::voiceKey() const {
+    return TtsEngine::voiceKey() + "|" + model_ + "|" + fileStamp(model_);
+}
+
 #else // WITH_PIPER is OFF
 
 // Stubs
 TtsPiper::TtsPiper(const std::string&, const std::string&) : lastErr_("Piper support is disabled in this build.") {}
+TtsPiper::~TtsPiper() {}
 bool TtsPiper::isAvailable() const { return false; }
 std::vector<int16_t> TtsPiper::synthesize(const std::string&, double&) { return {}; }
 const std::string& TtsPiper::lastError() const { return lastErr_; }
+std::string TtsPiper::voiceKey() const { return TtsEngine::voiceKey(); }
+bool TtsPiper::startWorker() { return false; }
+void TtsPiper::stopWorker() {}
+bool TtsPiper::readUtterance(std::vector<int16_t>&) { return false; }
 
 #endif // WITH_PIPER
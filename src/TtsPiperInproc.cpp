@@ -0,0 +1,209 @@
+#include "TtsPiperInproc.h"
+#include "Resampler.h"
+#include "Utils.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "nlohmann/json.hpp"
+
+bool isPiperInprocEngine(const std::string& engine) {
+    return engine == "piper-inproc" || engine == "piper_inproc";
+}
+
+std::string TtsPiperInproc::voiceKey() const {
+    return TtsEngine::voiceKey() + "|" + cfg_.modelPath + "|" + fileStamp(cfg_.modelPath)
+         + "|speaker=" + std::to_string(cfg_.speaker) + "|silence=" + std::to_string(cfg_.sentenceSilence);
+}
+
+#ifdef WITH_PIPER_INPROC
+#include <onnxruntime_cxx_api.h>
+#include <phonemize.hpp>
+#include <phoneme_ids.hpp>
+#include <espeak-ng/speak_lib.h>
+
+namespace {
+// First code point of a UTF-8 string (phoneme_id_map keys are single phonemes).
+char32_t firstCodePoint(const std::string& s) {
+    if (s.empty()) return 0;
+    const unsigned char c = static_cast<unsigned char>(s[0]);
+    int extra = c < 0x80 ? 0 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+    char32_t cp = extra == 0 ? c : c & (0x3F >> extra);
+    for (int i = 1; i <= extra && i < static_cast<int>(s.size()); ++i) {
+        cp = (cp << 6) | (static_cast<unsigned char>(s[i]) & 0x3F);
+    }
+    return cp;
+}
+
+std::mutex espeakMutex;
+bool espeakReady = false;
+}
+
+struct TtsPiperInproc::Voice {
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "piper"};
+    Ort::SessionOptions options;
+    std::unique_ptr<Ort::Session> session;
+    piper::eSpeakPhonemeConfig phonemes;
+    piper::PhonemeIdConfig ids;
+    float noiseScale = 0.667f;
+    float lengthScale = 1.0f;
+    float noiseW = 0.8f;
+    int numSpeakers = 1;
+};
+
+TtsPiperInproc::TtsPiperInproc(const PiperInprocConfig& cfg) : cfg_(cfg) {
+    if (cfg_.threads <= 0) {
+        cfg_.threads = static_cast<int>(std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+    }
+    auto t0 = std::chrono::steady_clock::now();
+
+    nlohmann::json config;
+    std::ifstream f(cfg_.modelPath + ".json");
+    try {
+        config = nlohmann::json::parse(f);
+    } catch (const std::exception& e) {
+        lastErr_ = "Could not read voice config " + cfg_.modelPath + ".json: " + e.what();
+        std::cerr << "[tts] " << lastErr_ << std::endl;
+        return;
+    }
+
+    {
+        // espeak-ng is process-wide: initialize it once for every voice.
+        std::lock_guard<std::mutex> lk(espeakMutex);
+        if (!espeakReady) {
+            if (espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, cfg_.espeakData.c_str(), 0) < 0) {
+                lastErr_ = "Failed to initialize espeak-ng with data from: " + cfg_.espeakData;
+                std::cerr << "[tts] " << lastErr_ << std::endl;
+                return;
+            }
+            espeakReady = true;
+        }
+    }
+
+    auto voice = std::make_unique<Voice>();
+    try {
+        voiceRate_ = config.at("audio").value("sample_rate", voiceRate_);
+        voice->phonemes.voice = config.at("espeak").value("voice", std::string("en-us"));
+        if (config.contains("inference")) {
+            const auto& inf = config["inference"];
+            voice->noiseScale = inf.value("noise_scale", voice->noiseScale);
+            voice->lengthScale = inf.value("length_scale", voice->lengthScale);
+            voice->noiseW = inf.value("noise_w", voice->noiseW);
+        }
+        voice->numSpeakers = config.value("num_speakers", 1);
+        auto idMap = std::make_shared<piper::PhonemeIdMap>();
+        for (const auto& item : config.at("phoneme_id_map").items()) {
+            (*idMap)[firstCodePoint(item.key())] = item.value().get<std::vector<piper::PhonemeId>>();
+        }
+        voice->ids.phonemeIdMap = idMap;
+    } catch (const std::exception& e) {
+        lastErr_ = "Invalid voice config " + cfg_.modelPath + ".json: " + e.what();
+        std::cerr << "[tts] " << lastErr_ << std::endl;
+        return;
+    }
+
+    try {
+        voice->options.SetIntraOpNumThreads(cfg_.threads);
+        voice->options.SetInterOpNumThreads(1);
+        voice->options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        voice->options.DisableProfiling();
+        voice->session = std::make_unique<Ort::Session>(voice->env, cfg_.modelPath.c_str(), voice->options);
+    } catch (const std::exception& e) {
+        lastErr_ = "Failed to load Piper voice " + cfg_.modelPath + ": " + e.what();
+        std::cerr << "[tts] " << lastErr_ << std::endl;
+        return;
+    }
+    voice_ = std::move(voice);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "[tts] Loaded Piper voice in-process in " << static_cast<int>(ms) << " ms ("
+              << voiceRate_ << " Hz, " << cfg_.threads << " threads)" << std::endl;
+}
+
+TtsPiperInproc::~TtsPiperInproc() = default;
+
+std::vector<int16_t> TtsPiperInproc::synthesize(const std::string& text, double& sampleRate) {
+    if (!voice_) return {};
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    std::vector<int16_t> audio;
+    try {
+        std::vector<std::vector<piper::Phoneme>> sentences;
+        piper::phonemize_eSpeak(text, voice_->phonemes, sentences);
+
+        Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        const char* inputNames[] = {"input", "input_lengths", "scales", "sid"};
+        const char* outputNames[] = {"output"};
+        const size_t silence = static_cast<size_t>(cfg_.sentenceSilence * voiceRate_);
+        std::vector<piper::PhonemeId> ids;
+        std::map<piper::Phoneme, std::size_t> missing;
+
+        for (const auto& sentence : sentences) {
+            ids.clear();
+            piper::phonemes_to_ids(sentence, voice_->ids, ids, missing);
+            if (ids.empty()) continue;
+
+            int64_t idShape[] = {1, static_cast<int64_t>(ids.size())};
+            int64_t length = static_cast<int64_t>(ids.size());
+            int64_t lengthShape[] = {1};
+            float scales[] = {voice_->noiseScale, voice_->lengthScale, voice_->noiseW};
+            int64_t scalesShape[] = {3};
+            int64_t speaker = cfg_.speaker;
+            int64_t speakerShape[] = {1};
+
+            std::vector<Ort::Value> inputs;
+            inputs.push_back(Ort::Value::CreateTensor<int64_t>(memory, ids.data(), ids.size(), idShape, 2));
+            inputs.push_back(Ort::Value::CreateTensor<int64_t>(memory, &length, 1, lengthShape, 1));
+            inputs.push_back(Ort::Value::CreateTensor<float>(memory, scales, 3, scalesShape, 1));
+            if (voice_->numSpeakers > 1) {
+                inputs.push_back(Ort::Value::CreateTensor<int64_t>(memory, &speaker, 1, speakerShape, 1));
+            }
+            auto outputs = voice_->session->Run(Ort::RunOptions{nullptr}, inputNames, inputs.data(), inputs.size(),
+                                                outputNames, 1);
+            if (outputs.empty()) continue;
+
+            // Same normalization as piper: scale the peak to full range.
+            const float* samples = outputs[0].GetTensorData<float>();
+            const size_t count = outputs[0].GetTensorTypeAndShapeInfo().GetElementCount();
+            float peak = 0.01f;
+            for (size_t i = 0; i < count; ++i) peak = std::max(peak, std::fabs(samples[i]));
+            const float scale = 32767.0f / peak;
+
+            if (!audio.empty()) audio.insert(audio.end(), silence, 0);
+            const size_t base = audio.size();
+            audio.resize(base + count);
+            for (size_t i = 0; i < count; ++i) {
+                float v = samples[i] * scale;
+                audio[base + i] = static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, v)));
+            }
+        }
+        if (!missing.empty()) {
+            std::cerr << "[tts] " << missing.size() << " phoneme(s) missing from the voice were skipped" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        lastErr_ = std::string("Piper synthesis failed: ") + e.what();
+        return {};
+    }
+
+    sampleRate = voiceRate_;
+    if (outputRate_ > 0 && outputRate_ != sampleRate) {
+        audio = resamplePcm(audio.data(), audio.size(), sampleRate, outputRate_);
+        sampleRate = outputRate_;
+    }
+    lastErr_.clear();
+    return audio;
+}
+
+#else // WITH_PIPER_INPROC is OFF
+
+struct TtsPiperInproc::Voice {};
+
+TtsPiperInproc::TtsPiperInproc(const PiperInprocConfig& cfg) : cfg_(cfg) {
+    lastErr_ = "In-process Piper support is disabled in this build.";
+}
+TtsPiperInproc::~TtsPiperInproc() = default;
+std::vector<int16_t> TtsPiperInproc::synthesize(const std::string&, double&) { return {}; }
+
+#endif // WITH_PIPER_INPROC
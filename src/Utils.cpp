@@ -1,8 +1,15 @@
 #include "Utils.h"
+#include "Resampler.h"
 #include <cctype>
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#if __has_include(<filesystem>)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+namespace std { namespace filesystem = experimental::filesystem; }
+#endif
 
 static inline bool is_space(char c) {
     return std::isspace(static_cast<unsigned char>(c));
@@ -65,9 +72,20 @@ std::string join(const std::vector<std::string>& items, const std::string& sep)
     return out;
 }
 
+std::string fileStamp(const std::string& path) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) return "";
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::to_string(size);
+    return std::to_string(size) + ":" + std::to_string(mtime.time_since_epoch().count());
+}
+
 #include <cmath>
 
-#ifdef WITH_VOSK
+#if defined(WITH_VOSK) || defined(WITH_WHISPER)
+#include "dr_wav.h"
+
 bool loadWav(const std::string& filePath, std::vector<int16_t>& pcm_data, uint32_t& sample_rate) {
     unsigned int channels;
     unsigned int sr;
@@ -94,31 +112,7 @@ bool loadWav(const std::string& filePath, std::vector<int16_t>& pcm_data, uint32
 #endif
 
 std::vector<int16_t> resample(const std::vector<int16_t>& pcm_in, double sample_rate_in, double sample_rate_out) {
-    if (sample_rate_in == sample_rate_out) {
-        return pcm_in;
-    }
-
-    double ratio = sample_rate_in / sample_rate_out;
-    size_t out_len = static_cast<size_t>(pcm_in.size() / ratio);
-    std::vector<int16_t> pcm_out(out_len);
-
-    for (size_t i = 0; i < out_len; ++i) {
-        double in_idx_f = i * ratio;
-        size_t in_idx_i = static_cast<size_t>(in_idx_f);
-        double frac = in_idx_f - in_idx_i;
-
-        if (in_idx_i + 1 < pcm_in.size()) {
-            // Linear interpolation
-            pcm_out[i] = static_cast<int16_t>(
-                pcm_in[in_idx_i] * (1.0 - frac) + pcm_in[in_idx_i + 1] * frac
-            );
-        } else {
-            // Last sample
-            pcm_out[i] = pcm_in.back();
-        }
-    }
-
-    return pcm_out;
+    return resamplePcm(pcm_in.data(), pcm_in.size(), sample_rate_in, sample_rate_out);
 }
 
 // Helper to write little-endian values
@@ -0,0 +1,104 @@
+#include "Vad.h"
+#include <cmath>
+#include <algorithm>
+
+Vad::Vad(const VadConfig& cfg) : cfg_(cfg) {
+    reset();
+}
+
+void Vad::reset() {
+    noiseDb_ = cfg_.minEnergyDb;
+    noiseInit_ = false;
+    lastSpeech_ = false;
+    inSpeech_ = false;
+    speechFound_ = false;
+    endpointed_ = false;
+    runSpeechMs_ = 0.0;
+    runSilenceMs_ = 0.0;
+    speechMs_ = 0.0;
+}
+
+double Vad::energyDb(const int16_t* frame, size_t samples) {
+    if (samples == 0) return -100.0;
+    int64_t acc = 0;
+    for (size_t i = 0; i < samples; ++i) {
+        acc += static_cast<int32_t>(frame[i]) * frame[i];
+    }
+    double meanSq = static_cast<double>(acc) / samples / (32768.0 * 32768.0);
+    return 10.0 * std::log10(meanSq + 1e-10);
+}
+
+double Vad::zeroCrossingRate(const int16_t* frame, size_t samples) {
+    if (samples < 2) return 0.0;
+    size_t crossings = 0;
+    for (size_t i = 1; i < samples; ++i) {
+        crossings += (frame[i - 1] >= 0) != (frame[i] >= 0);
+    }
+    return static_cast<double>(crossings) / (samples - 1);
+}
+
+VadEvent Vad::process(const int16_t* frame, size_t samples, double sampleRate) {
+    if (samples == 0 || sampleRate <= 0) return VadEvent::None;
+    const double frameMs = samples * 1000.0 / sampleRate;
+    const double e = energyDb(frame, samples);
+    const double zcr = zeroCrossingRate(frame, samples);
+
+    if (!noiseInit_) {
+        // Seed from the first frame, capped so that a user who starts talking
+        // immediately is not mistaken for background noise.
+        noiseDb_ = std::min(std::max(e, cfg_.minEnergyDb), cfg_.minEnergyDb + 15.0);
+        noiseInit_ = true;
+    }
+
+    const double threshold = std::max(cfg_.minEnergyDb, noiseDb_ + cfg_.marginDb);
+    lastSpeech_ = e > threshold && (zcr < cfg_.maxZcr || e > noiseDb_ + cfg_.strongMarginDb);
+
+    // Track the noise floor: drop quickly to quieter frames, rise slowly
+    // while not in speech so that steady background noise is absorbed.
+    if (e < noiseDb_) {
+        noiseDb_ = 0.7 * noiseDb_ + 0.3 * e;
+    } else if (!lastSpeech_) {
+        noiseDb_ = 0.98 * noiseDb_ + 0.02 * e;
+    }
+    noiseDb_ = std::max(noiseDb_, cfg_.minEnergyDb - cfg_.marginDb);
+
+    if (endpointed_) return VadEvent::None;
+
+    if (lastSpeech_) {
+        runSpeechMs_ += frameMs;
+        runSilenceMs_ = 0.0;
+        if (inSpeech_) {
+            speechMs_ += frameMs;
+        } else if (runSpeechMs_ >= cfg_.minSpeechMs) {
+            inSpeech_ = true;
+            speechFound_ = true;
+            speechMs_ += runSpeechMs_;
+            return VadEvent::SpeechStart;
+        }
+        return VadEvent::None;
+    }
+
+    runSilenceMs_ += frameMs;
+    if (!inSpeech_) {
+        // A burst shorter than minSpeechMs was noise (click, bump...).
+        runSpeechMs_ = 0.0;
+        return VadEvent::None;
+    }
+    if (runSilenceMs_ >= cfg_.hangoverMs) {
+        inSpeech_ = false;
+        endpointed_ = true;
+        runSpeechMs_ = 0.0;
+        return VadEvent::SpeechEnd;
+    }
+    return VadEvent::None;
+}
+
+bool Vad::containsSpeech(const std::vector<int16_t>& pcm, double sampleRate, const VadConfig& cfg, int frameMs) {
+    Vad vad(cfg);
+    const size_t frame = std::max<size_t>(1, static_cast<size_t>(sampleRate * frameMs / 1000.0));
+    for (size_t pos = 0; pos + frame <= pcm.size(); pos += frame) {
+        vad.process(pcm.data() + pos, frame, sampleRate);
+        if (vad.hasSpeech()) return true;
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+#include "WakeWord.h"
+#include "AsrVosk.h"
+#include "Utils.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include "nlohmann/json.hpp"
+
+#ifdef WITH_VOSK
+#include <vosk_api.h>
+
+static std::string toLowerAscii(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c){ return std::tolower(c); });
+    return s;
+}
+
+WakeWordDetector::WakeWordDetector(AsrVosk& asr, const WakeWordConfig& cfg)
+    : asr_(asr), cfg_(cfg) {
+    std::istringstream iss(toLowerAscii(cfg_.word));
+    std::string w;
+    while (iss >> w) words_.push_back(w);
+
+    if (words_.empty()) {
+        lastError_ = "Wake word is empty.";
+    } else if (!asr_.isAvailable() || asr_.model() == nullptr) {
+        lastError_ = "Vosk model not available for wake-word spotting.";
+    } else {
+        available_ = true;
+        for (const auto& word : words_) {
+            if (vosk_model_find_word(asr_.model(), word.c_str()) < 0) {
+                // The grammar would only ever produce [unk] for this word.
+                lastError_ = "Wake word '" + word + "' is not in the model vocabulary.";
+                available_ = false;
+            }
+        }
+    }
+    if (!available_) {
+        std::cerr << "[wake] " << lastError_ << std::endl;
+    }
+}
+
+WakeWordDetector::~WakeWordDetector() {
+    if (rec_ != nullptr) {
+        vosk_recognizer_free(rec_);
+    }
+}
+
+bool WakeWordDetector::ensureRecognizer(double sampleRate) {
+    if (rec_ != nullptr && recRate_ == sampleRate) return true;
+    if (rec_ != nullptr) {
+        vosk_recognizer_free(rec_);
+        rec_ = nullptr;
+    }
+
+    // Restricting the decoding graph to the wake word keeps the spotter cheap.
+    nlohmann::json grammar = nlohmann::json::array({ join(words_, " "), "[unk]" });
+    rec_ = vosk_recognizer_new_grm(asr_.model(), static_cast<float>(sampleRate), grammar.dump().c_str());
+    if (rec_ == nullptr) {
+        lastError_ = "Failed to create wake-word recognizer.";
+        available_ = false;
+        return false;
+    }
+    vosk_recognizer_set_words(rec_, 1);
+    recRate_ = sampleRate;
+
+    leadIn_.assign(static_cast<size_t>(sampleRate * cfg_.leadInMs / 1000.0), 0);
+    leadInPos_ = 0;
+    leadInFill_ = 0;
+    return true;
+}
+
+void WakeWordDetector::pushLeadIn(const int16_t* frame, size_t samples) {
+    if (leadIn_.empty()) return;
+    for (size_t i = 0; i < samples; ++i) {
+        leadIn_[leadInPos_] = frame[i];
+        leadInPos_ = (leadInPos_ + 1) % leadIn_.size();
+    }
+    leadInFill_ = std::min(leadIn_.size(), leadInFill_ + samples);
+}
+
+void WakeWordDetector::reset() {
+    if (rec_ != nullptr && gateOpen_) {
+        vosk_recognizer_reset(rec_);
+    }
+    gateOpen_ = false;
+    burstMs_ = 0.0;
+    silenceMs_ = 0.0;
+    leadInFill_ = 0;
+    gate_.reset();
+}
+
+bool WakeWordDetector::process(const int16_t* frame, size_t samples, double sampleRate) {
+    stats_.framesSeen++;
+    if (!available_ || samples == 0 || !ensureRecognizer(sampleRate)) return false;
+
+    // Stage 1: energy gate. Silence never reaches the decoder.
+    gate_.process(frame, samples, sampleRate);
+    const bool voiced = gate_.lastFrameIsSpeech();
+    if (!gateOpen_) {
+        if (!voiced) {
+            pushLeadIn(frame, samples);
+            return false;
+        }
+        gateOpen_ = true;
+        burstMs_ = 0.0;
+        silenceMs_ = 0.0;
+        stats_.bursts++;
+        // Replay the lead-in so the onset of the word is decoded too.
+        size_t start = (leadInPos_ + leadIn_.size() - leadInFill_) % std::max<size_t>(1, leadIn_.size());
+        size_t first = std::min(leadInFill_, leadIn_.size() - start);
+        if (first > 0) vosk_recognizer_accept_waveform_s(rec_, &leadIn_[start], static_cast<int>(first));
+        if (leadInFill_ > first) vosk_recognizer_accept_waveform_s(rec_, &leadIn_[0], static_cast<int>(leadInFill_ - first));
+        leadInFill_ = 0;
+    }
+
+    stats_.framesDecoded++;
+    burstMs_ += samples * 1000.0 / sampleRate;
+    silenceMs_ = voiced ? 0.0 : silenceMs_ + samples * 1000.0 / sampleRate;
+
+    if (vosk_recognizer_accept_waveform_s(rec_, frame, static_cast<int>(samples))) {
+        // Kaldi found an endpoint inside the burst: check it right away.
+        if (confirm(vosk_recognizer_result(rec_))) {
+            reset();
+            return true;
+        }
+    }
+    if (silenceMs_ >= cfg_.gateSilenceMs || burstMs_ >= cfg_.maxBurstMs) {
+        return finishBurst();
+    }
+    return false;
+}
+
+bool WakeWordDetector::finishBurst() {
+    std::string result = vosk_recognizer_final_result(rec_);
+    vosk_recognizer_reset(rec_);
+    gateOpen_ = false;
+    burstMs_ = 0.0;
+    silenceMs_ = 0.0;
+    return confirm(result);
+}
+
+bool WakeWordDetector::confirm(const std::string& resultJson) {
+    nlohmann::json j;
+    try {
+        j = nlohmann::json::parse(resultJson);
+    } catch (const nlohmann::json::parse_error&) {
+        return false;
+    }
+    if (!j.contains("result") || !j["result"].is_array()) return false;
+
+    // Stage 2: the wake word must appear as a run of confident words.
+    const auto& res = j["result"];
+    for (size_t i = 0; i + words_.size() <= res.size(); ++i) {
+        bool match = true;
+        double minConf = 1.0;
+        for (size_t k = 0; k < words_.size() && match; ++k) {
+            const auto& w = res[i + k];
+            match = toLowerAscii(w.value("word", "")) == words_[k];
+            minConf = std::min(minConf, w.value("conf", 0.0));
+        }
+        if (!match) continue;
+
+        stats_.candidates++;
+        lastConfidence_ = minConf;
+        double duration = res[i + words_.size() - 1].value("end", 0.0) - res[i].value("start", 0.0);
+        if (minConf >= cfg_.minConfidence && duration >= cfg_.minWordSeconds) {
+            stats_.detections++;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // WITH_VOSK
@@ -17,18 +17,37 @@ namespace std { namespace filesystem = experimental::filesystem; }
 #include <sstream>
 
 #include "OpenAIClient.h"
+#include "ConversationContext.h"
+#include "ResponseCache.h"
 #include "Audio.h"
 #include "Utils.h"
 #include "Memory.h"
+#include "Vad.h"
+#include "Resampler.h"
+#include "AudioConditioner.h"
+#include "Env.h"
+#include "Bench.h"
 
 #ifdef WITH_VOSK
 #include "AsrVosk.h"
+#include "AsrSession.h"
+#include "AsrBatch.h"
+#include "CommandGrammar.h"
+#include "WakeWord.h"
+#endif
+#ifdef WITH_WHISPER
+#include "AsrWhisper.h"
 #endif
 #ifdef WITH_PIPER
 #include "TtsPiper.h"
+#include "TtsPiperInproc.h"
+#include "TtsPipeline.h"
+#include "TtsCache.h"
 #endif
 #ifdef WITH_AUDIO
 #include "Audio.h"
+#include "AudioPlayer.h"
+#include "AudioSession.h"
 #endif
 
 #ifdef WITH_HTTP
@@ -41,6 +60,7 @@ struct AppCfg {
     std::string apiBase = "http://localhost:8000/v1";
     std::string apiKey  = "EMPTY";
     std::string model   = "gpt-4o-mini";
+    bool http2 = true;   // LLM_HTTP2: negotiate HTTP/2 with https endpoints
 };
 static AppCfg loadCfg(const std::string& path) {
     AppCfg c;
@@ -59,6 +79,7 @@ static AppCfg loadCfg(const std::string& path) {
         if (p==std::string::npos) continue;
         std::string k=trim(line.substr(0,p)), v=trim(line.substr(p+1));
         if (k=="API_BASE") c.apiBase=v; else if (k=="API_KEY") c.apiKey=v; else if (k=="MODEL") c.model=v;
+        else if (k=="LLM_HTTP2") c.http2 = !(v=="0"||v=="false"||v=="off");
     }
     return c;
 }
@@ -129,6 +150,83 @@ static void printDeviceList() {
 }
 #endif
 
+#ifdef WITH_AUDIO
+// Waits for an LLM reply while listening to the user. Speech heard while the
+// speaker is silent (so not our own TTS) cancels the request; it is then left
+// in `speech`, from just before its onset, and the capture stays armed so the
+// rest of the utterance waits in the ring for the next turn.
+static bool waitOrBargeIn(ChatHandle& pending, AudioCapture& cap, AudioPlayer& player,
+                          const VadConfig& vadCfg, std::vector<int16_t>& speech) {
+    const double rate = cap.sampleRate();
+    const size_t frameSamples = static_cast<size_t>(rate / 100.0);
+    const size_t lead = static_cast<size_t>(rate * (vadCfg.minSpeechMs + 300) / 1000.0);
+    std::vector<int16_t> frame(frameSamples);
+    Vad vad(vadCfg);
+    speech.clear();
+
+    const bool wasArmed = cap.isArmed();
+    cap.arm();
+    while (!pending.waitFor(0)) {
+        if (!cap.waitFrame(frame.data(), frameSamples, 10)) continue;
+        if (player.isPlaying()) {
+            speech.clear();
+            vad.reset();
+            continue;
+        }
+        speech.insert(speech.end(), frame.begin(), frame.end());
+        if (vad.process(frame.data(), frameSamples, rate) == VadEvent::SpeechStart) {
+            pending.cancel();
+            return true;
+        }
+        if (!vad.inSpeech() && speech.size() > lead) {
+            speech.erase(speech.begin(), speech.end() - static_cast<std::ptrdiff_t>(lead));
+        }
+    }
+    if (!wasArmed) cap.disarm();
+    speech.clear();
+    return false;
+}
+#endif
+
+#if defined(WITH_AUDIO) && defined(WITH_VOSK)
+// Hands-free capture: waits for the wake word on the always-open stream, then
+// streams the following utterance to sink until it returns false or
+// maxSeconds pass.
+static bool captureAfterWakeWord(AudioCapture& cap, WakeWordDetector& wake, int maxSeconds, const FrameSink& sink) {
+    const double rate = cap.sampleRate();
+    const size_t frameSamples = static_cast<size_t>(rate / 100.0);
+    std::vector<int16_t> frame(frameSamples);
+
+    // A barge-in turn records through recordFrames(), which disarms the
+    // stream; wake mode needs the live audio back.
+    cap.arm();
+    // Whatever was captured while we were busy (including our own TTS) is stale.
+    cap.discard();
+    wake.reset();
+    std::cout << "[wake] Listening for the wake word..." << std::endl;
+    while (true) {
+        if (!cap.waitFrame(frame.data(), frameSamples, 100)) {
+            if (!cap.isRunning()) return false;
+            continue;
+        }
+        if (wake.process(frame.data(), frameSamples, rate)) break;
+    }
+    std::cout << "[wake] Wake word detected (conf " << wake.lastConfidence() << "), recording..." << std::endl;
+
+    const size_t maxSamples = static_cast<size_t>(maxSeconds * rate);
+    size_t total = 0;
+    while (total < maxSamples) {
+        if (!cap.waitFrame(frame.data(), frameSamples, 100)) {
+            if (!cap.isRunning()) break;
+            continue;
+        }
+        total += frameSamples;
+        if (!sink(frame.data(), frameSamples)) break;
+    }
+    return true;
+}
+#endif
+
 #ifdef WITH_PIPER
 #include "TtsPiper.h"
 #endif
@@ -138,21 +236,57 @@ static void printDeviceList() {
 struct Args {
     bool help = false;
     bool offline = false;
+    bool llmStream = true;
+    double llmTimeout = 120.0;
+    int historyTokens = 1024;
+    bool llmCache = false;
+    std::string llmCacheFile = "data/llm_cache.json";
+    int llmCacheTtl = 24 * 3600;
+    std::string llmCacheBypass;
     bool withAudio = false;
     bool listDevices = false;
+    bool refreshAudioCache = false;
     int recordSeconds = 5;
     std::string inKey, outKey;
+#if defined(WITH_VOSK) || defined(WITH_WHISPER)
+    std::string sttFromWav;
+    std::string sttDumpJson;
+#endif
 #ifdef WITH_VOSK
     // ASR options
     bool withVosk = false;
     std::string voskModel;
-    std::string sttFromWav;
-    std::string sttDumpJson;
+    std::string sttBatch;
+    std::string sttOut = "stt_batch.jsonl";
+    int sttThreads = 0;
+    std::string sttLong;
+    double sttSegmentSeconds = 20.0;
+    bool asrCommands = false;
+    double asrCommandConf = 0.85;
+    // Wake word options
+    bool wake = false;
+    std::string wakeWord;
+    double wakeConf = 0.65;
+    std::string benchWake;
+#endif
+#ifdef WITH_WHISPER
+    // whisper.cpp options (engine picked by ASR_ENGINE or --asr-engine)
+    std::string asrEngine;
+    std::string whisperModel;
+    int whisperThreads = 0;
+    std::string whisperLang;
+    int whisperBeam = 0;
+    bool whisperNoTrim = false;
 #endif
     // Piper TTS options
     bool withPiper = false;
     std::string piperBin;
     std::string piperModel;
+    bool piperInproc = false;
+    int piperThreads = 0;
+    std::string ttsCacheDir = "data/tts_cache";
+    int ttsCacheMb = 32;
+    bool noTtsCache = false;
     std::string say;
     // PTT mode
     bool ptt = false;
@@ -179,6 +313,21 @@ struct Args {
     std::string loopSaveWavs;
     std::string logJsonl;
 
+    // Voice activity endpointing
+    bool noVad = false;
+    int vadSilenceMs = 700;
+    int vadMinSpeechMs = 200;
+    int preRollMs = 500;
+    bool bargeIn = false;
+
+    // Pre-ASR conditioning
+    ConditionerConfig cond;
+
+    // Benchmarks
+    bool benchResample = false;
+    std::string benchResamplePairs;
+    int benchSeconds = 600;
+
     // HTTP Server options
     bool http = false;
     std::string httpHost = "127.0.0.1";
@@ -191,10 +340,18 @@ static void printHelp() {
     std::cout << "Usage: home_assistant [options]\n\n"
               << "General Options:\n"
               << "  --help                Show this help message and exit.\n"
-              << "  --offline             Run in offline mode (no API calls, echoes input).\n\n"
+              << "  --offline             Run in offline mode (no API calls, echoes input).\n"
+              << "  --no-llm-stream       Wait for the whole LLM reply instead of streaming it as it is generated.\n"
+              << "  --llm-timeout <sec>   Give up on an LLM reply after this long (default: 120, 0 = never).\n"
+              << "  --history-tokens <N>  Prompt budget for conversation history, in tokens (default: 1024, 0 = no history).\n"
+              << "  --llm-cache           Answer repeated questions from a response cache instead of the LLM.\n"
+              << "  --llm-cache-file <path> Persistent tier of the response cache (default: data/llm_cache.json, \"\" = memory only).\n"
+              << "  --llm-cache-ttl <sec> Lifetime of cached replies (default: 86400).\n"
+              << "  --llm-cache-bypass <w1,w2> Extra words whose questions are never cached (time words are built in).\n\n"
               << "Audio Options (require building with -DWITH_AUDIO=ON):\n"
               << "  --with-audio          Enable audio input/output via PortAudio.\n"
               << "  --list-devices        List available audio devices and exit.\n"
+              << "  --refresh-audio-cache Re-probe device sample rates instead of using data/audio_devices.json.\n"
               << "  --input-device <key>  Keyword or index for input device.\n"
               << "  --output-device <key> Keyword or index for output device.\n"
               << "  --record-seconds <N>  Hard cap for recording duration (default: 5s).\n"
@@ -202,15 +359,41 @@ static void printHelp() {
               << "  --save-wav <path>     If set, save capture to WAV. If path is a dir, use a timestamped filename.\n"
               << "  --sample-rate-in <Hz> Requested input sample rate (default: 16000). Falls back if unsupported.\n\n"
               << "ASR/TTS Options:\n"
+#if defined(WITH_VOSK) || defined(WITH_WHISPER)
+              << "  --stt-from-wav <path> Transcribe a WAV file and print the text (no audio stack needed).\n"
+              << "  --stt-dump-json <path> Optional: write full ASR result to a JSON file.\n"
+#endif
 #ifdef WITH_VOSK
               << "  --with-vosk           Enable Vosk ASR feature path (e.g. for PTT transcription).\n"
               << "  --vosk-model <dir>    Path to the Vosk model directory.\n"
-              << "  --stt-from-wav <path> Transcribe a WAV file and print the text (no audio stack needed).\n"
-              << "  --stt-dump-json <path> Optional: write full ASR result to a JSON file.\n"
+              << "  --stt-batch <dir|wav|list> Transcribe many WAVs with one model (dirs are searched recursively).\n"
+              << "  --stt-out <path>      JSONL output of --stt-batch (default: stt_batch.jsonl).\n"
+              << "  --stt-threads <N>     Decoding threads (default: 0 = all cores).\n"
+              << "  --stt-long <wav>      Transcribe one long recording in parallel segments cut at pauses.\n"
+              << "  --stt-segment-seconds <N> Target segment length for --stt-long (default: 20).\n"
+              << "  --asr-commands        Loop: decode commands on a restricted grammar first (fast path).\n"
+              << "  --asr-command-conf <0..1> Minimum per-word confidence for the command fast path (default: 0.85).\n"
+              << "  --wake                Hands-free loop: wait for the wake word instead of Enter.\n"
+              << "  --wake-word <word>    Wake word (default: WAKE_WORD from config/app.env).\n"
+              << "  --wake-conf <0..1>    Minimum wake-word confidence (default: 0.65).\n"
+              << "  --bench-wake <wav|idle> Report wake-word CPU cost on a WAV or synthetic idle audio.\n"
+#endif
+#ifdef WITH_WHISPER
+              << "  --asr-engine <name>   vosk or whisper (default: ASR_ENGINE from config/app.env).\n"
+              << "  --whisper-model <path> ggml model file, quantized ones included (default: WHISPER_MODEL).\n"
+              << "  --whisper-threads <N> Decoding threads (default: WHISPER_THREADS, else up to 8 cores).\n"
+              << "  --whisper-lang <code> Spoken language or auto (default: from LANG, e.g. fr).\n"
+              << "  --whisper-beam <N>    Beam search width (default: 0 = greedy).\n"
+              << "  --whisper-no-trim     Decode the whole capture instead of the VAD-trimmed speech.\n"
 #endif
               << "  --with-piper          Enable Piper TTS (requires build with -DWITH_PIPER=ON).\n"
               << "  --piper-bin <path>    Optional path to the 'piper' executable.\n"
               << "  --piper-model <path>  Path to the Piper TTS model file (.onnx), required if --with-piper.\n"
+              << "  --piper-inproc        Run the voice in-process (build with -DWITH_PIPER_INPROC=ON; or TTS_ENGINE=piper-inproc).\n"
+              << "  --piper-threads <N>   onnxruntime threads for --piper-inproc (default: PIPER_THREADS, else up to 4).\n"
+              << "  --tts-cache-dir <dir> On-disk cache of synthesized phrases (default: data/tts_cache).\n"
+              << "  --tts-cache-mb <N>    In-memory cache size (default: 32).\n"
+              << "  --no-tts-cache        Synthesize every phrase again.\n"
               << "  --say \"<text>\"        Synthesize and speak text using Piper, then exit.\n\n"
               << "Memory/State Options:\n"
               << "  --mem-set <key> <val> Set a key-value fact.\n"
@@ -229,7 +412,16 @@ static void printHelp() {
               << "  --loop-max-turns <N>  Exit after N turns (default: 0 = unlimited).\n"
               << "  --loop-ptt-seconds <N>  Fallback cap if VAD doesn’t stop (default: 10s).\n"
               << "  --loop-save-wavs <dir> If set, save input WAVs + TTS WAVs in that dir.\n"
-              << "  --log-jsonl <path>    Append JSONL logs of each turn.\n\n"
+              << "  --log-jsonl <path>    Append JSONL logs of each turn.\n"
+              << "  --vad-silence-ms <N>  Stop recording N ms after speech ends (default: 700).\n"
+              << "  --vad-min-speech-ms <N> Ignore sounds shorter than N ms (default: 200).\n"
+              << "  --no-vad              Disable VAD endpointing (stop on Enter or cap only).\n"
+              << "  --pre-roll-ms <N>     Audio kept from before each turn starts (default: 500).\n"
+              << "  --barge-in            Keep listening while the LLM replies; speaking cancels the reply and starts the next turn.\n"
+              << "  --asr-cond <stages>   Conditioning before ASR: comma list of hpf,ns,agc, or none (default: hpf).\n\n"
+              << "Benchmarks:\n"
+              << "  --bench-resample [in:out,...] Resampler throughput vs. linear interpolation (default: common pairs).\n"
+              << "  --bench-seconds <N>   Length of synthetic benchmark audio (default: 600s).\n\n"
               << "HTTP Server Options (require building with -DWITH_HTTP=ON):\n"
               << "  --http                Enable HTTP server.\n"
               << "  --http-host <host>    HTTP server host (default: 127.0.0.1).\n"
@@ -246,17 +438,46 @@ static Args parseArgs(int argc, char** argv) {
 
         if (s == "--help") a.help = true;
         else if (s == "--offline") a.offline = true;
+        else if (s == "--no-llm-stream") a.llmStream = false;
+        else if (s == "--llm-cache") a.llmCache = true;
+        else if (s == "--llm-cache-file") next(a.llmCacheFile);
+        else if (s == "--llm-cache-ttl") { std::string v; next(v); a.llmCacheTtl = std::max(1, std::atoi(v.c_str())); }
+        else if (s == "--llm-cache-bypass") next(a.llmCacheBypass);
+        else if (s == "--history-tokens") { std::string v; next(v); a.historyTokens = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--llm-timeout") { std::string v; next(v); a.llmTimeout = std::max(0.0, std::atof(v.c_str())); }
         else if (s == "--with-audio") a.withAudio = true;
         else if (s == "--list-devices") a.listDevices = true;
+        else if (s == "--refresh-audio-cache") a.refreshAudioCache = true;
         else if (s == "--record-seconds") { std::string v; next(v); a.recordSeconds = std::max(1, std::atoi(v.c_str())); }
         else if (s == "--input-device") next(a.inKey);
         else if (s == "--output-device") next(a.outKey);
+#if defined(WITH_VOSK) || defined(WITH_WHISPER)
+        else if (s == "--stt-from-wav") next(a.sttFromWav);
+        else if (s == "--stt-dump-json") next(a.sttDumpJson);
+#endif
 #ifdef WITH_VOSK
         // ASR
         else if (s == "--with-vosk") a.withVosk = true;
         else if (s == "--vosk-model") next(a.voskModel);
-        else if (s == "--stt-from-wav") next(a.sttFromWav);
-        else if (s == "--stt-dump-json") next(a.sttDumpJson);
+        else if (s == "--stt-batch") next(a.sttBatch);
+        else if (s == "--stt-out") next(a.sttOut);
+        else if (s == "--stt-threads") { std::string v; next(v); a.sttThreads = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--stt-long") next(a.sttLong);
+        else if (s == "--asr-commands") a.asrCommands = true;
+        else if (s == "--asr-command-conf") { std::string v; next(v); a.asrCommandConf = std::atof(v.c_str()); }
+        else if (s == "--stt-segment-seconds") { std::string v; next(v); a.sttSegmentSeconds = std::max(5.0, std::atof(v.c_str())); }
+        else if (s == "--wake") { a.wake = true; a.withAudio = true; a.withVosk = true; }
+        else if (s == "--wake-word") next(a.wakeWord);
+        else if (s == "--wake-conf") { std::string v; next(v); a.wakeConf = std::atof(v.c_str()); }
+        else if (s == "--bench-wake") next(a.benchWake);
+#endif
+#ifdef WITH_WHISPER
+        else if (s == "--asr-engine") next(a.asrEngine);
+        else if (s == "--whisper-model") next(a.whisperModel);
+        else if (s == "--whisper-threads") { std::string v; next(v); a.whisperThreads = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--whisper-lang") next(a.whisperLang);
+        else if (s == "--whisper-beam") { std::string v; next(v); a.whisperBeam = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--whisper-no-trim") a.whisperNoTrim = true;
 #endif
         // PTT
         else if (s == "--ptt") { a.ptt = true; a.withAudio = true; }
@@ -266,6 +487,11 @@ static Args parseArgs(int argc, char** argv) {
         else if (s == "--with-piper") a.withPiper = true;
         else if (s == "--piper-bin") next(a.piperBin);
         else if (s == "--piper-model") next(a.piperModel);
+        else if (s == "--piper-inproc") a.piperInproc = true;
+        else if (s == "--piper-threads") { std::string v; next(v); a.piperThreads = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--tts-cache-dir") next(a.ttsCacheDir);
+        else if (s == "--tts-cache-mb") { std::string v; next(v); a.ttsCacheMb = std::max(1, std::atoi(v.c_str())); }
+        else if (s == "--no-tts-cache") a.noTtsCache = true;
         else if (s == "--say") next(a.say);
         // Memory args
         else if (s == "--mem-set") { if (i + 2 < argc) { a.memSet.push_back(argv[++i]); a.memSet.push_back(argv[++i]); } }
@@ -285,6 +511,20 @@ static Args parseArgs(int argc, char** argv) {
         else if (s == "--loop-ptt-seconds") { std::string v; next(v); a.loopPttSeconds = std::max(1, std::atoi(v.c_str())); }
         else if (s == "--loop-save-wavs") next(a.loopSaveWavs);
         else if (s == "--log-jsonl") next(a.logJsonl);
+        else if (s == "--no-vad") a.noVad = true;
+        else if (s == "--barge-in") a.bargeIn = true;
+        else if (s == "--pre-roll-ms") { std::string v; next(v); a.preRollMs = std::max(0, std::atoi(v.c_str())); }
+        else if (s == "--asr-cond") {
+            std::string v; next(v);
+            if (!parseConditionerStages(v, a.cond)) std::cerr << "[cond] Unknown stage list: " << v << std::endl;
+        }
+        else if (s == "--bench-resample") {
+            a.benchResample = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') a.benchResamplePairs = argv[++i];
+        }
+        else if (s == "--bench-seconds") { std::string v; next(v); a.benchSeconds = std::max(1, std::atoi(v.c_str())); }
+        else if (s == "--vad-silence-ms") { std::string v; next(v); a.vadSilenceMs = std::max(50, std::atoi(v.c_str())); }
+        else if (s == "--vad-min-speech-ms") { std::string v; next(v); a.vadMinSpeechMs = std::max(0, std::atoi(v.c_str())); }
         // HTTP server args
         else if (s == "--http") a.http = true;
         else if (s == "--http-host") next(a.httpHost);
@@ -299,6 +539,78 @@ static Args parseArgs(int argc, char** argv) {
     return a;
 }
 
+// The response cache selected by --llm-cache, else null.
+static std::unique_ptr<ResponseCache> makeResponseCache(const Args& args, const std::string& model) {
+    if (!args.llmCache) return nullptr;
+    ResponseCacheConfig cfg;
+    cfg.path = args.llmCacheFile;
+    cfg.ttlSeconds = args.llmCacheTtl;
+    std::stringstream words(args.llmCacheBypass);
+    std::string word;
+    while (std::getline(words, word, ',')) {
+        if (!word.empty()) cfg.rules.insert(cfg.rules.begin(), ResponseCacheRule{word, 0});
+    }
+    auto cache = std::make_unique<ResponseCache>(model, OpenAIClient::kSystemPrompt, cfg);
+    std::cout << "[llm] Response cache: " << cache->stats().entries << " entries loaded from "
+              << (cfg.path.empty() ? std::string("(memory only)") : cfg.path) << std::endl;
+    return cache;
+}
+
+#ifdef WITH_PIPER
+// Fixed replies spoken by the loop and PTT, pre-synthesized into the TTS cache.
+static const std::vector<std::string> kConfirmationPhrases = {
+    "Note enregistrée.",
+    "OK, j'ai compris.",
+};
+
+// Piper voice: in-process when built for it and selected by --piper-inproc
+// or TTS_ENGINE=piper-inproc, else the persistent piper worker process.
+static std::unique_ptr<TtsEngine> makePiper(const Args& args) {
+#ifdef WITH_PIPER_INPROC
+    EnvConfig env = loadEnvFile("config/app.env");
+    if (args.piperInproc || isPiperInprocEngine(env.ttsEngine)) {
+        PiperInprocConfig cfg;
+        cfg.modelPath = args.piperModel;
+        cfg.threads = args.piperThreads > 0 ? args.piperThreads : env.piperThreads;
+        if (!args.piperBin.empty()) {
+            cfg.espeakData = (std::filesystem::path(args.piperBin).parent_path() / "espeak-ng-data").string();
+        }
+        return std::make_unique<TtsPiperInproc>(cfg);
+    }
+#endif
+    return std::make_unique<TtsPiper>(args.piperModel, args.piperBin);
+}
+#endif
+
+#ifdef WITH_WHISPER
+// The whisper engine when ASR_ENGINE (or --asr-engine) selects it, else null.
+static std::unique_ptr<AsrWhisper> makeWhisper(const Args& args) {
+    EnvConfig env = loadEnvFile("config/app.env");
+    if (!isWhisperEngine(!args.asrEngine.empty() ? args.asrEngine : env.asrEngine)) return nullptr;
+    WhisperConfig cfg;
+    cfg.modelPath = !args.whisperModel.empty() ? args.whisperModel : env.whisperModel;
+    cfg.threads = args.whisperThreads > 0 ? args.whisperThreads : env.whisperThreads;
+    cfg.language = !args.whisperLang.empty() ? args.whisperLang : env.lang.substr(0, 2);
+    cfg.beamSize = args.whisperBeam;
+    cfg.vadTrim = !args.whisperNoTrim;
+    auto whisper = std::make_unique<AsrWhisper>(cfg);
+    if (!whisper->isAvailable()) {
+        std::cerr << "[asr-whisper] Error: " << whisper->lastError() << std::endl;
+    }
+    return whisper;
+}
+
+// Conditions and decodes one captured utterance.
+static std::string transcribeWithWhisper(AsrWhisper& whisper, std::vector<int16_t> pcm, double sampleRate,
+                                         const ConditionerConfig& cond) {
+    if (cond.anyEnabled()) pcm = AudioConditioner(cond).processBuffer(pcm, sampleRate);
+    AsrResult r = whisper.recognize(pcm, sampleRate);
+    std::cout << "[asr-whisper] Decoded in " << static_cast<int>(r.decodeMs) << " ms ("
+              << r.words.size() << " words, mean confidence " << r.confidence() << ")" << std::endl;
+    return r.text;
+}
+#endif
+
 int main(int argc, char** argv) {
     Args args = parseArgs(argc, argv);
 
@@ -313,12 +625,28 @@ int main(int argc, char** argv) {
 
 #ifdef WITH_AUDIO
     Audio audio;
+    if (args.refreshAudioCache) {
+        Audio::clearRateCache();
+    }
 #endif
 #ifdef WITH_VOSK
     AsrVosk asr(args.voskModel);
 #endif
 #ifdef WITH_PIPER
-    TtsPiper piper(args.piperModel, args.piperBin);
+    // Loaded once and shared by the loop, --say and PTT.
+    std::unique_ptr<TtsEngine> tts;
+    TtsCache* tts_cache = nullptr;
+    if (args.withPiper) {
+        tts = makePiper(args);
+        if (!args.noTtsCache && tts->isAvailable()) {
+            TtsCacheConfig cache_cfg;
+            cache_cfg.dir = args.ttsCacheDir;
+            cache_cfg.memoryBytes = static_cast<size_t>(args.ttsCacheMb) << 20;
+            auto cache = std::make_unique<TtsCache>(std::move(tts), cache_cfg);
+            tts_cache = cache.get();
+            tts = std::move(cache);
+        }
+    }
 #endif
 
     if (args.loop) {
@@ -338,6 +666,23 @@ int main(int argc, char** argv) {
                 return 1;
             }
         }
+        // Both streams are negotiated once and stay open for the whole loop:
+        // TTS is queued and plays while the loop moves on, and the input's
+        // pre-roll window catches speech that starts just before a turn.
+        AudioSession session;
+        if (args.withAudio) {
+            AudioSessionConfig session_cfg;
+            session_cfg.inputDevice = inIdx;
+            session_cfg.outputDevice = outIdx;
+            session_cfg.inputRate = args.sampleRateIn;
+            session_cfg.preRollMs = args.preRollMs;
+            if (!session.open(session_cfg)) {
+                std::cerr << "Error: Could not open the audio session." << std::endl;
+                return 1;
+            }
+        }
+        AudioCapture& capture = session.capture();
+        AudioPlayer& player = session.player();
 #endif
 
 #ifdef WITH_VOSK
@@ -346,9 +691,47 @@ int main(int argc, char** argv) {
         }
 #endif
 
+#if defined(WITH_AUDIO) && defined(WITH_VOSK)
+        // Hands-free mode: the capture stream stays armed and feeds the wake-word spotter.
+        std::unique_ptr<WakeWordDetector> wake;
+        if (args.wake) {
+            WakeWordConfig wake_cfg;
+            wake_cfg.word = !args.wakeWord.empty() ? args.wakeWord : loadEnvFile("config/app.env").wakeWord;
+            wake_cfg.minConfidence = args.wakeConf;
+            wake = std::make_unique<WakeWordDetector>(asr, wake_cfg);
+            if (!wake->isAvailable()) {
+                std::cerr << "Error: Wake word unavailable: " << wake->lastError() << std::endl;
+                return 1;
+            }
+            capture.arm();
+            std::cout << "[wake] Hands-free mode, wake word: \"" << wake_cfg.word << "\"" << std::endl;
+        }
+#endif
+
 #ifdef WITH_PIPER
-        if (args.withPiper && !piper.isAvailable()) {
-            std::cerr << "[tts] Piper is enabled but not available: " << piper.lastError() << ". TTS will be skipped." << std::endl;
+        if (tts && !tts->isAvailable()) {
+            std::cerr << "[tts] Piper is enabled but not available: " << tts->lastError() << ". TTS will be skipped." << std::endl;
+        }
+#ifdef WITH_AUDIO
+        // Convert once at synthesis time, straight to the device rate.
+        if (tts && player.isOpen()) {
+            tts->setOutputRate(player.sampleRate());
+        }
+#endif
+        // Each sentence is queued for playback as soon as it is synthesized.
+        std::unique_ptr<TtsPipeline> tts_pipeline;
+        if (tts && tts->isAvailable()) {
+            tts_pipeline = std::make_unique<TtsPipeline>(*tts, [&](const std::vector<int16_t>& pcm, double rate, bool more) {
+#ifdef WITH_AUDIO
+                if (args.withAudio && player.isOpen()) return player.enqueue(pcm, rate, more);
+#endif
+                return true;
+            });
+            tts_pipeline->setKeepAudio(!args.loopSaveWavs.empty());
+        }
+        // The fixed confirmations, at the final output rate, so they play at once.
+        if (tts_cache && tts_cache->isAvailable()) {
+            tts_cache->prewarm(kConfirmationPhrases);
         }
 #endif
 
@@ -360,8 +743,10 @@ int main(int argc, char** argv) {
         if ((e=getenv("API_BASE"))) cfg.apiBase = e;
         if ((e=getenv("API_KEY" ))) cfg.apiKey  = e;
         if ((e=getenv("MODEL"   ))) cfg.model   = e;
-        OpenAIClient client(cfg.apiBase, cfg.apiKey, cfg.model, args.offline);
+        OpenAIClient client(cfg.apiBase, cfg.apiKey, cfg.model, args.offline, cfg.http2);
+        client.setTimeout(args.llmTimeout);
         std::cout << "[cfg] API_BASE=" << cfg.apiBase << " MODEL=" << cfg.model << "\n";
+        std::unique_ptr<ResponseCache> resp_cache = args.offline ? nullptr : makeResponseCache(args, cfg.model);
 
 #ifdef WITH_HTTP
         if (args.http) {
@@ -372,7 +757,7 @@ int main(int argc, char** argv) {
             http_opts.enable_ws = !args.noWs;
             http_server = std::make_unique<HttpServer>(http_opts, &mem,
 #ifdef WITH_PIPER
-                &piper,
+                tts.get(),
 #else
                 nullptr,
 #endif
@@ -391,6 +776,39 @@ int main(int argc, char** argv) {
         }
 #endif
 
+#ifdef WITH_WHISPER
+        // Replaces Vosk for the whole loop when selected.
+        std::unique_ptr<AsrWhisper> whisper = makeWhisper(args);
+#endif
+
+#if defined(WITH_AUDIO) && defined(WITH_VOSK)
+        // Decodes while the user speaks; conditioning runs on the ASR-rate
+        // stream only, VAD and saved WAVs see raw audio.
+        std::unique_ptr<CommandGrammar> commands;
+        std::unique_ptr<AsrSession> asr_session;
+        bool vosk_streaming = args.withAudio && args.withVosk && asr.isAvailable();
+#ifdef WITH_WHISPER
+        if (whisper) vosk_streaming = false;
+#endif
+        if (vosk_streaming) {
+            if (args.asrCommands) {
+                commands = std::make_unique<CommandGrammar>(asr, args.asrCommandConf);
+                commands->update(mem);
+            }
+            asr_session = std::make_unique<AsrSession>(asr, args.cond, commands.get());
+            asr_session->setPartialCallback([](const std::string& partial) {
+                std::cout << "[asr] partial: " << partial << std::endl;
+            });
+        }
+#endif
+
+#ifdef WITH_AUDIO
+        std::vector<int16_t> barge_pcm;   // start of an utterance that interrupted the last reply
+#endif
+        ContextConfig context_cfg;
+        context_cfg.maxTokens = static_cast<size_t>(args.historyTokens);
+        ConversationContext convo(context_cfg);
+
         for (int turn = 1; args.loopMaxTurns == 0 || turn <= args.loopMaxTurns; ++turn) {
             std::cout << "\n--- Turn " << turn << " ---" << std::endl;
 
@@ -400,17 +818,76 @@ int main(int argc, char** argv) {
 
 #ifdef WITH_AUDIO
             if (args.withAudio) {
-                std::cout << "[audio] Press Enter to start recording (" << args.loopPttSeconds << "s max)... " << std::flush;
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-                std::cout << "Recording..." << std::endl;
-
-                audio.recordPtt(inIdx, args.loopPttSeconds, sample_rate, pcm_data);
+                // Don't record the tail of the previous reply.
+                player.waitIdle();
+
+                VadConfig vad_cfg;
+                vad_cfg.hangoverMs = args.vadSilenceMs;
+                vad_cfg.minSpeechMs = args.vadMinSpeechMs;
+                Vad vad(vad_cfg);
+                sample_rate = capture.sampleRate();
+                pcm_data.reserve(static_cast<size_t>((args.loopPttSeconds + 1) * sample_rate));
+#ifdef WITH_VOSK
+                if (commands) commands->update(mem);  // no-op unless facts changed
+                if (asr_session) asr_session->open(sample_rate);
+#endif
+                auto vad_sink = [&](const int16_t* frame, size_t samples) {
+                    pcm_data.insert(pcm_data.end(), frame, frame + samples);
+#ifdef WITH_VOSK
+                    if (asr_session) asr_session->feed(frame, samples);
+#endif
+                    if (args.noVad) return true;
+                    VadEvent ev = vad.process(frame, samples, sample_rate);
+                    if (ev == VadEvent::SpeechStart) {
+                        std::cout << "[vad] Speech detected." << std::endl;
+                    } else if (ev == VadEvent::SpeechEnd) {
+                        std::cout << "[vad] End of speech, stopping." << std::endl;
+                        return false;
+                    }
+                    return true;
+                };
+
+                if (!barge_pcm.empty()) {
+                    // The user is already talking: no prompt or wake word.
+                    std::cout << "Recording..." << std::endl;
+                    const size_t frame = static_cast<size_t>(sample_rate / 100.0);
+                    bool more = true;
+                    for (size_t i = 0; more && i < barge_pcm.size(); i += frame) {
+                        more = vad_sink(barge_pcm.data() + i, std::min(frame, barge_pcm.size() - i));
+                    }
+                    barge_pcm.clear();
+                    if (more) audio.recordFrames(capture, args.loopPttSeconds, 10, vad_sink);
+                } else
+#ifdef WITH_VOSK
+                if (wake) {
+                    if (!captureAfterWakeWord(capture, *wake, args.loopPttSeconds, vad_sink)) {
+                        std::cerr << "[wake] Input stream stopped, leaving the loop." << std::endl;
+                        break;
+                    }
+                } else
+#endif
+                {
+                    std::cout << "[audio] Press Enter to start recording (" << args.loopPttSeconds << "s max)... " << std::flush;
+                    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                    std::cout << "Recording..." << std::endl;
+                    audio.recordFrames(capture, args.loopPttSeconds, 10, vad_sink);
+                }
 
                 if (pcm_data.empty()) {
                     std::cout << "[audio] No audio recorded, skipping turn." << std::endl;
+#ifdef WITH_VOSK
+                    if (asr_session) asr_session->cancel();
+#endif
                     continue;
                 }
                 std::cout << "[audio] Recorded " << pcm_data.size() << " samples." << std::endl;
+                if (!args.noVad && !vad.hasSpeech()) {
+                    std::cout << "[vad] Only silence recorded, skipping turn." << std::endl;
+#ifdef WITH_VOSK
+                    if (asr_session) asr_session->cancel();
+#endif
+                    continue;
+                }
 
                 if (!args.loopSaveWavs.empty()) {
                     std::filesystem::path save_dir(args.loopSaveWavs);
@@ -438,8 +915,31 @@ int main(int argc, char** argv) {
 
             std::string userText;
 
+#ifdef WITH_WHISPER
+            if (whisper) {
+                if (whisper->isAvailable() && !pcm_data.empty()) {
+                    userText = transcribeWithWhisper(*whisper, pcm_data, sample_rate, args.cond);
+                    std::cout << "[asr] Transcript: \"" << userText << "\"" << std::endl;
+                }
+            } else
+#endif
+            {
 #ifdef WITH_VOSK
             if (args.withVosk && asr.isAvailable()) {
+#ifdef WITH_AUDIO
+                if (asr_session && asr_session->isOpen()) {
+                    userText = asr_session->finish();
+                    AsrSessionStats st = asr_session->stats();
+                    std::cout << "[asr] Final transcript " << static_cast<int>(st.finishMs)
+                              << " ms after end of capture (" << static_cast<int>(st.audioSeconds * 1000.0)
+                              << " ms of audio decoded while recording"
+                              << (st.commandFastPath ? ", command grammar" : st.commandPrefix ? ", command prefix" : "") << ")" << std::endl;
+                    if (args.cond.anyEnabled()) {
+                        std::cout << asr_session->conditionerStatsLine() << std::endl;
+                    }
+                    std::cout << "[asr] Transcript: \"" << userText << "\"" << std::endl;
+                } else
+#endif
                 if (!pcm_data.empty()) {
                     std::cout << "[asr] Transcribing..." << std::endl;
                     userText = asr.transcribe(pcm_data, sample_rate);
@@ -447,6 +947,7 @@ int main(int argc, char** argv) {
                 }
             }
 #endif
+            }
 
             // If transcription is empty (e.g. silence, or ASR not used/available)
             if (userText.empty()) {
@@ -460,6 +961,14 @@ int main(int argc, char** argv) {
             }
 
             std::string assistantText;
+            ChatResult llm;   // timings of this turn's request, if one was sent
+            bool interrupted = false;
+            bool cache_hit = false;
+            // Cache entries depend on the exchange before the question.
+            const std::string cache_context = resp_cache ? convo.lastExchange() : std::string();
+#ifdef WITH_PIPER
+            bool tts_streamed = false;
+#endif
 
             // 3. Intent/memory
             Intent intent = parseIntent(userText);
@@ -492,36 +1001,134 @@ int main(int argc, char** argv) {
                 // 4. LLM reply
                 if (args.offline) {
                     assistantText = "(offline) Echo: " + userText;
+                    std::cout << "[llm] Assistant reply: \"" << assistantText << "\"" << std::endl;
+                } else if (resp_cache && resp_cache->lookup(userText, cache_context, assistantText)) {
+                    // Spoken like a non-streamed reply by the TTS step.
+                    cache_hit = true;
+                    convo.commit(userText, assistantText);
+                    std::cout << "[llm] Assistant reply (cached): \"" << assistantText << "\"" << std::endl;
                 } else {
-                    std::cout << "[llm] Sending to OpenAI..." << std::endl;
-                    ChatResult r = client.chatOnce(userText);
-                    if (r.ok) {
-                        assistantText = r.text;
+                    // With streaming, the reply is printed as it is generated and
+                    // complete sentences start synthesizing before the rest arrives.
+                    std::cout << "[llm] Sending to OpenAI" << (args.llmStream ? " (streaming)..." : "...") << std::endl;
+                    OpenAIClient::ChatOptions chat_opts;
+                    chat_opts.stream = args.llmStream;
+                    if (args.llmStream) {
+#ifdef WITH_PIPER
+                        if (tts_pipeline) {
+                            tts_pipeline->begin();
+                            tts_streamed = true;
+                        }
+#endif
+                        std::cout << "[llm] Assistant reply: " << std::flush;
+#ifdef WITH_PIPER
+                        // Runs on the request thread: capture by value. After a
+                        // cancel() the pipeline ignores further pushes.
+                        TtsPipeline* tts_target = tts_streamed ? tts_pipeline.get() : nullptr;
+                        chat_opts.onDelta = [tts_target](const std::string& delta) {
+                            std::cout << delta << std::flush;
+                            if (tts_target) tts_target->push(delta);
+                        };
+#else
+                        chat_opts.onDelta = [](const std::string& delta) {
+                            std::cout << delta << std::flush;
+                        };
+#endif
+                    }
+                    // The request runs on its own thread, so the user can interrupt it.
+                    std::vector<ChatMessage> messages = convo.messagesFor(userText);
+                    if (convo.lastEvicted() > 0) {
+                        std::cout << "[llm] History over budget: dropped the " << convo.lastEvicted()
+                                  << " oldest turns, " << convo.turns() << " kept" << std::endl;
+                    }
+                    ChatHandle pending = client.chatAsync(std::move(messages), std::move(chat_opts));
+#ifdef WITH_PIPER
+                    bool tts_cancelled = false;
+#endif
+#ifdef WITH_AUDIO
+                    if (args.bargeIn && args.withAudio) {
+                        VadConfig barge_cfg;
+                        barge_cfg.hangoverMs = args.vadSilenceMs;
+                        barge_cfg.minSpeechMs = args.vadMinSpeechMs;
+                        if (waitOrBargeIn(pending, capture, player, barge_cfg, barge_pcm)) {
+#ifdef WITH_PIPER
+                            if (tts_streamed) tts_pipeline->cancel();
+                            tts_cancelled = true;
+#endif
+                            player.flush();
+                        }
+                    }
+#endif
+                    llm = pending.get();
+#ifdef WITH_PIPER
+                    // Only now is the request thread done with the pipeline.
+                    if (tts_cancelled) tts_streamed = false;
+#endif
+                    if (args.llmStream) std::cout << std::endl;
+
+                    if (llm.cancelled) {
+                        std::cout << "[loop] Reply interrupted by the user after " << static_cast<int>(llm.totalMs) << " ms." << std::endl;
+                        interrupted = true;
+                    } else if (llm.ok) {
+                        assistantText = llm.text;
+                        convo.commit(userText, llm.text, llm.promptTokens);
+                        if (resp_cache) resp_cache->store(userText, cache_context, llm.text);
+                        if (args.llmStream) {
+                            std::cout << "[llm] First token after " << static_cast<int>(llm.firstTokenMs) << " ms, "
+                                      << llm.tokens << " tokens in " << static_cast<int>(llm.totalMs) << " ms ("
+                                      << static_cast<int>(llm.tokensPerSec * 10) / 10.0 << " tokens/s)" << std::endl;
+                        }
+                        std::cout << "[llm] Prompt: ";
+                        if (llm.promptTokens > 0) {
+                            std::cout << llm.promptTokens << " tokens";
+                            if (llm.cachedTokens > 0) std::cout << " (" << llm.cachedTokens << " cached)";
+                        } else {
+                            std::cout << "~" << convo.promptEstimate() << " tokens (estimated)";
+                        }
+                        std::cout << ", history " << convo.turns() << " turns" << std::endl;
                     } else {
-                        assistantText = "[error] " + (!r.error.empty() ? r.error : r.text);
+                        assistantText = "[error] " + (!llm.error.empty() ? llm.error : llm.text);
                         std::cerr << "[llm] " << assistantText << std::endl;
+#ifdef WITH_PIPER
+                        // Speak the error instead of a truncated reply.
+                        if (tts_streamed) tts_pipeline->cancel();
+                        tts_streamed = false;
+#endif
                     }
+                    if (!args.llmStream) std::cout << "[llm] Assistant reply: \"" << assistantText << "\"" << std::endl;
+                }
+                if (!args.offline && llm.httpVersion > 0) {
+                    std::cout << "[llm] HTTP/" << (llm.httpVersion == 2 ? "2" : "1.1") << ", "
+                              << (llm.reusedConnection ? std::string("connection reused")
+                                                       : "connected in " + std::to_string(static_cast<int>(llm.connectMs)) + " ms")
+                              << ", first byte after " << static_cast<int>(llm.ttfbMs) << " ms" << std::endl;
                 }
-                std::cout << "[llm] Assistant reply: \"" << assistantText << "\"" << std::endl;
             }
 
             // 5. TTS
             bool tts_done = false;
 #ifdef WITH_PIPER
-            if (args.withPiper && piper.isAvailable()) {
-                if (!assistantText.empty()) {
+            TtsPipelineStats tts_stats;
+            if (tts_pipeline) {
+                if (tts_streamed) {
+                    // The reply was pushed while it streamed in: flush the last sentence.
+                    tts_pipeline->end();
+                    tts_stats = tts_pipeline->wait();
+                } else if (!assistantText.empty()) {
                     std::cout << "[tts] Synthesizing..." << std::endl;
-                    double tts_sample_rate = 0;
-                    std::vector<int16_t> tts_pcm = piper.synthesize(assistantText, tts_sample_rate);
+                    tts_stats = tts_pipeline->speak(assistantText);
+                }
+                if (!assistantText.empty()) {
+                    if (tts_stats.failed > 0) {
+                        std::cerr << "[tts] TTS synthesis failed for " << tts_stats.failed << " of "
+                                  << (tts_stats.chunks + tts_stats.failed) << " chunks: " << tts_pipeline->lastError() << std::endl;
+                    }
 
-                    if (!tts_pcm.empty()) {
+                    if (tts_stats.chunks > 0) {
                         tts_done = true;
-#ifdef WITH_AUDIO
-                        if (args.withAudio) {
-                            std::cout << "[audio] Playing TTS..." << std::endl;
-                            audio.playback(outIdx, tts_sample_rate, tts_pcm);
-                        }
-#endif
+                        std::cout << "[tts] First audio after " << static_cast<int>(tts_stats.firstAudioMs) << " ms ("
+                                  << tts_stats.chunks << " chunks, " << static_cast<int>(tts_stats.synthMs)
+                                  << " ms of synthesis for " << tts_stats.audioSeconds << " s of audio)" << std::endl;
                         if (!args.loopSaveWavs.empty()) {
                             std::filesystem::path save_dir(args.loopSaveWavs);
                              try {
@@ -531,7 +1138,7 @@ int main(int argc, char** argv) {
                                 std::string timestamp = generateTimestamp("%Y%m%d_%H%M%S");
                                 std::string filename = "tts_" + timestamp + ".wav";
                                 std::filesystem::path full_path = save_dir / filename;
-                                if (saveWav(full_path.string(), tts_pcm, static_cast<int32_t>(tts_sample_rate))) {
+                                if (saveWav(full_path.string(), tts_pipeline->audio(), static_cast<int32_t>(tts_pipeline->sampleRate()))) {
                                     std::cout << "[tts] TTS audio saved to " << full_path.string() << std::endl;
                                 } else {
                                     std::cerr << "[tts] Failed to save TTS WAV to " << full_path.string() << std::endl;
@@ -540,8 +1147,6 @@ int main(int argc, char** argv) {
                                 std::cerr << "[io] Error with path " << args.loopSaveWavs << ": " << e.what() << std::endl;
                             }
                         }
-                    } else {
-                        std::cerr << "[tts] TTS synthesis failed: " << piper.lastError() << std::endl;
                     }
                 }
             }
@@ -566,7 +1171,34 @@ int main(int argc, char** argv) {
                 log_entry["intent"] = intent_json;
 
                 log_entry["assistant_text"] = assistantText;
+                log_entry["interrupted"] = interrupted;
+                if (resp_cache) {
+                    log_entry["llm_cache_hit"] = cache_hit;
+                    log_entry["llm_cache_hit_rate"] = resp_cache->stats().hitRate();
+                }
+                if (llm.ok) {
+                    log_entry["llm_prompt_tokens"] = llm.promptTokens > 0 ? llm.promptTokens : static_cast<int>(convo.promptEstimate());
+                    log_entry["llm_prompt_tokens_estimated"] = llm.promptTokens <= 0;
+                    log_entry["llm_cached_tokens"] = llm.cachedTokens;
+                    log_entry["history_turns"] = convo.turns();
+                }
+                log_entry["llm_first_token_ms"] = llm.ok && llm.firstTokenMs >= 0 ? nlohmann::json(llm.firstTokenMs) : nlohmann::json(nullptr);
+                log_entry["llm_tokens_per_s"] = llm.ok && llm.firstTokenMs >= 0 ? nlohmann::json(llm.tokensPerSec) : nlohmann::json(nullptr);
+                if (llm.httpVersion > 0) {
+                    log_entry["llm_connect_ms"] = llm.connectMs;
+                    log_entry["llm_ttfb_ms"] = llm.ttfbMs;
+                    log_entry["llm_conn_reused"] = llm.reusedConnection;
+                }
                 log_entry["tts_done"] = tts_done;
+#ifdef WITH_PIPER
+                log_entry["tts_first_audio_ms"] = tts_stats.chunks > 0 ? nlohmann::json(tts_stats.firstAudioMs) : nlohmann::json(nullptr);
+                log_entry["tts_chunks"] = tts_stats.chunks;
+                if (tts_cache) {
+                    TtsCacheStats cs = tts_cache->stats();
+                    log_entry["tts_cache_hits"] = cs.hits();
+                    log_entry["tts_cache_misses"] = cs.misses;
+                }
+#endif
 
                 std::ofstream log_file(args.logJsonl, std::ios::app);
                 if (log_file) {
@@ -582,6 +1214,17 @@ int main(int argc, char** argv) {
             }
         }
 
+#ifdef WITH_AUDIO
+        if (player.isOpen()) {
+            player.waitIdle();
+            PlaybackStats ps = player.stats();
+            std::cout << "[audio] Played " << player.playedSeconds() << "s, underruns: " << ps.underruns << std::endl;
+        }
+#endif
+#ifdef WITH_PIPER
+        if (tts_cache) std::cout << tts_cache->statsLine() << std::endl;
+#endif
+        if (resp_cache) std::cout << resp_cache->statsLine() << std::endl;
         std::cout << "[loop] Loop finished." << std::endl;
         return 0;
     }
@@ -600,7 +1243,7 @@ int main(int argc, char** argv) {
 
         http_server = std::make_unique<HttpServer>(http_opts, &mem,
 #ifdef WITH_PIPER
-            &piper,
+            tts.get(),
 #else
             nullptr,
 #endif
@@ -706,7 +1349,105 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    // --- Resampler benchmark ---
+    if (args.benchResample) {
+        return runResampleBench(args.benchResamplePairs, args.benchSeconds);
+    }
+
+#ifdef WITH_WHISPER
+    // --- Offline STT from WAV file, whisper engine ---
+    if (!args.sttFromWav.empty()) {
+        if (std::unique_ptr<AsrWhisper> whisper = makeWhisper(args)) {
+            if (!whisper->isAvailable()) return 1;
+            std::vector<int16_t> pcm;
+            uint32_t sample_rate;
+            if (!loadWav(args.sttFromWav, pcm, sample_rate)) {
+                return 1;
+            }
+            std::cout << "[asr] Loaded " << pcm.size() << " samples from " << args.sttFromWav << " (rate: " << sample_rate << ")" << std::endl;
+
+            if (args.cond.anyEnabled()) {
+                AudioConditioner conditioner(args.cond);
+                pcm = conditioner.processBuffer(pcm, sample_rate);
+                std::cout << conditioner.statsLine() << std::endl;
+            }
+
+            AsrResult result = whisper->recognize(pcm, sample_rate);
+            std::cout << "[asr-whisper] Decoded in " << static_cast<int>(result.decodeMs) << " ms ("
+                      << result.words.size() << " words, mean confidence " << result.confidence() << ")" << std::endl;
+            std::cout << "Transcript: " << result.text << std::endl;
+
+            if (!args.sttDumpJson.empty()) {
+                std::ofstream out(args.sttDumpJson);
+                if (out) {
+                    out << result.json;
+                    std::cout << "[asr] Dumped full JSON result to " << args.sttDumpJson << std::endl;
+                } else {
+                    std::cerr << "Error: Could not write to JSON file: " << args.sttDumpJson << std::endl;
+                }
+            }
+            return 0;
+        }
+    }
+#endif
+
 #ifdef WITH_VOSK
+    // --- Wake-word CPU benchmark ---
+    if (!args.benchWake.empty()) {
+        if (args.voskModel.empty()) {
+            std::cerr << "Error: --vosk-model <dir> is required for --bench-wake." << std::endl;
+            return 1;
+        }
+        AsrVosk asr(args.voskModel);
+        if (!asr.isAvailable()) {
+            std::cerr << "Error: " << asr.lastError() << std::endl;
+            return 1;
+        }
+        WakeWordConfig wake_cfg;
+        wake_cfg.word = !args.wakeWord.empty() ? args.wakeWord : loadEnvFile("config/app.env").wakeWord;
+        wake_cfg.minConfidence = args.wakeConf;
+        return runWakeWordBench(asr, wake_cfg, args.benchWake == "idle" ? "" : args.benchWake, args.benchSeconds);
+    }
+
+    // --- Batch STT over many WAV files ---
+    if (!args.sttBatch.empty()) {
+        if (args.voskModel.empty()) {
+            std::cerr << "Error: --vosk-model <dir> is required for --stt-batch." << std::endl;
+            return 1;
+        }
+        AsrVosk asr(args.voskModel);
+        if (!asr.isAvailable()) {
+            std::cerr << "Error: " << asr.lastError() << std::endl;
+            return 1;
+        }
+        AsrBatchConfig batch_cfg;
+        batch_cfg.input = args.sttBatch;
+        batch_cfg.outputPath = args.sttOut;
+        batch_cfg.threads = args.sttThreads;
+        batch_cfg.cond = args.cond;
+        return runBatchTranscription(asr, batch_cfg);
+    }
+
+    // --- Long recording, segmented and decoded in parallel ---
+    if (!args.sttLong.empty()) {
+        if (args.voskModel.empty()) {
+            std::cerr << "Error: --vosk-model <dir> is required for --stt-long." << std::endl;
+            return 1;
+        }
+        AsrVosk asr(args.voskModel);
+        if (!asr.isAvailable()) {
+            std::cerr << "Error: " << asr.lastError() << std::endl;
+            return 1;
+        }
+        AsrLongConfig long_cfg;
+        long_cfg.input = args.sttLong;
+        long_cfg.outputPath = args.sttDumpJson;
+        long_cfg.threads = args.sttThreads;
+        long_cfg.segmentSeconds = args.sttSegmentSeconds;
+        long_cfg.cond = args.cond;
+        return runLongTranscription(asr, long_cfg);
+    }
+
     // --- Offline STT from WAV file ---
     if (!args.sttFromWav.empty()) {
         if (args.voskModel.empty()) {
@@ -728,14 +1469,22 @@ int main(int argc, char** argv) {
             return 1;
         }
 
-        std::string transcript = asr.transcribe(pcm, sample_rate);
-        std::cout << "Transcript: " << transcript << std::endl;
+        if (args.cond.anyEnabled()) {
+            AudioConditioner conditioner(args.cond);
+            pcm = conditioner.processBuffer(pcm, sample_rate);
+            std::cout << conditioner.statsLine() << std::endl;
+        }
+
+        // One decode serves both the transcript and the JSON dump.
+        AsrResult result = asr.recognize(pcm, sample_rate);
+        std::cout << "[asr] Decoded in " << static_cast<int>(result.decodeMs) << " ms ("
+                  << result.words.size() << " words, mean confidence " << result.confidence() << ")" << std::endl;
+        std::cout << "Transcript: " << result.text << std::endl;
 
         if (!args.sttDumpJson.empty()) {
-            std::string full_json = asr.transcribe_and_get_full_json(pcm, sample_rate);
             std::ofstream out(args.sttDumpJson);
             if (out) {
-                out << full_json;
+                out << result.json;
                 std::cout << "[asr] Dumped full JSON result to " << args.sttDumpJson << std::endl;
             } else {
                 std::cerr << "Error: Could not write to JSON file: " << args.sttDumpJson << std::endl;
@@ -753,18 +1502,17 @@ int main(int argc, char** argv) {
             return 1;
         }
 
-        TtsPiper piper(args.piperModel, args.piperBin);
-        if (!piper.isAvailable()) {
-            std::cerr << "Error: Piper is not available. " << piper.lastError() << std::endl;
+        if (!tts->isAvailable()) {
+            std::cerr << "Error: Piper is not available. " << tts->lastError() << std::endl;
             return 1;
         }
 
         std::cout << "[tts] Synthesizing text: \"" << args.say << "\"" << std::endl;
         double sampleRate = 0;
-        std::vector<int16_t> pcm = piper.synthesize(args.say, sampleRate);
+        std::vector<int16_t> pcm = tts->synthesize(args.say, sampleRate);
 
         if (pcm.empty()) {
-            std::cerr << "Error: TTS synthesis failed. " << piper.lastError() << std::endl;
+            std::cerr << "Error: TTS synthesis failed. " << tts->lastError() << std::endl;
             return 1;
         }
 
@@ -802,8 +1550,7 @@ int main(int argc, char** argv) {
 
 
 #ifdef WITH_AUDIO
-    // Must be constructed for Pa_Initialize/Terminate RAII
-    Audio audio;
+    // `audio` (constructed above) keeps Pa_Initialize/Terminate RAII for the whole run.
     if (args.listDevices) {
         printDeviceList();
         return 0;
@@ -818,14 +1565,51 @@ int main(int argc, char** argv) {
         }
         std::cout << "[audio] Using input device index: " << inIdx << std::endl;
 
-        std::cout << "[audio] Press Enter to start recording (" << args.recordSeconds << "s max)...";
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
+        // Open the stream before prompting so the pre-roll window already
+        // holds what was said while Enter was being pressed.
         std::vector<int16_t> pcm;
         double sampleRate = args.sampleRateIn;
+        AudioCapture capture;
+        capture.setPreRollMs(args.preRollMs);
+        if (!capture.open(inIdx, sampleRate, 4.0)) {
+            return 1;
+        }
+        capture.disarm();
+        capture.start();
+
+#ifdef WITH_WHISPER
+        std::unique_ptr<AsrWhisper> whisper = makeWhisper(args);
+#endif
+#ifdef WITH_VOSK
+        // Decode while recording so the transcript is ready as soon as Enter is released.
+        std::unique_ptr<AsrSession> asr_session;
+        bool vosk_ptt = args.withVosk;
+#ifdef WITH_WHISPER
+        if (whisper) vosk_ptt = false;
+#endif
+        if (vosk_ptt && !args.voskModel.empty() && asr.isAvailable()) {
+            asr_session = std::make_unique<AsrSession>(asr, args.cond);
+            asr_session->setPartialCallback([](const std::string& partial) {
+                std::cout << "[asr] partial: " << partial << std::endl;
+            });
+            asr_session->open(sampleRate);
+        }
+#endif
+
+        std::cout << "[audio] Press Enter to start recording (" << args.recordSeconds << "s max)...";
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
         std::cout << "[audio] Recording..." << std::endl;
-        audio.recordPtt(inIdx, args.recordSeconds, sampleRate, pcm);
+        pcm.reserve(static_cast<size_t>((args.recordSeconds + 1) * sampleRate));
+        audio.recordFrames(capture, args.recordSeconds, 10, [&](const int16_t* frame, size_t samples) {
+            pcm.insert(pcm.end(), frame, frame + samples);
+#ifdef WITH_VOSK
+            if (asr_session) asr_session->feed(frame, samples);
+#endif
+            return true;
+        });
+        capture.close();
+        std::cout << "[audio] Recording finished. Total duration: " << (double)pcm.size() / sampleRate << "s" << std::endl;
 
         if (!args.saveWavPath.empty()) {
             std::string finalPath = args.saveWavPath;
@@ -893,40 +1677,52 @@ int main(int argc, char** argv) {
             }
         }
 
+#ifdef WITH_WHISPER
+        // --- PTT with whisper ---
+        if (whisper && whisper->isAvailable()) {
+            if (pcm.empty()) {
+                std::cout << "[asr] No audio recorded, skipping transcription." << std::endl;
+            } else {
+                std::cout << "Transcript: " << transcribeWithWhisper(*whisper, pcm, sampleRate, args.cond) << std::endl;
+            }
+        }
+#endif
 #ifdef WITH_VOSK
         // --- PTT with ASR ---
-        if (args.withVosk) {
+        if (vosk_ptt) {
             if (args.voskModel.empty()) {
                 std::cerr << "Error: --vosk-model <dir> is required when using --with-vosk in PTT mode." << std::endl;
             } else if (pcm.empty()) {
                 std::cout << "[asr] No audio recorded, skipping transcription." << std::endl;
             } else {
-                AsrVosk asr(args.voskModel);
-                if (asr.isAvailable()) {
-                    std::cout << "[asr] Transcribing recorded audio..." << std::endl;
-                    std::string transcript = asr.transcribe(pcm, sampleRate);
+                if (asr_session && asr_session->isOpen()) {
+                    std::string transcript = asr_session->finish();
+                    std::cout << "[asr] Final transcript " << static_cast<int>(asr_session->stats().finishMs)
+                              << " ms after end of capture" << std::endl;
+                    if (args.cond.anyEnabled()) {
+                        std::cout << asr_session->conditionerStatsLine() << std::endl;
+                    }
                     std::cout << "Transcript: " << transcript << std::endl;
 #ifdef WITH_PIPER
                     if (args.withPiper && !args.piperModel.empty()) {
                         std::cout << "[tts] Synthesizing confirmation..." << std::endl;
-                        TtsPiper piper(args.piperModel, args.piperBin);
-                        if (piper.isAvailable()) {
+                        if (tts->isAvailable()) {
                             double ttsSampleRate = 0;
                             std::string confirmation = "OK, j'ai compris.";
-                            std::vector<int16_t> ttsPcm = piper.synthesize(confirmation, ttsSampleRate);
+                            std::vector<int16_t> ttsPcm = tts->synthesize(confirmation, ttsSampleRate);
                             if (!ttsPcm.empty()) {
                                 int outIdx = Audio::findDevice(args.outKey, true);
                                 audio.playback(outIdx, ttsSampleRate, ttsPcm);
                             } else {
-                                std::cerr << "[tts] Error: " << piper.lastError() << std::endl;
+                                std::cerr << "[tts] Error: " << tts->lastError() << std::endl;
                             }
                         } else {
-                             std::cerr << "[tts] Error: " << piper.lastError() << std::endl;
+                             std::cerr << "[tts] Error: " << tts->lastError() << std::endl;
                         }
                     }
 #endif
                 } else {
-                    std::cerr << "Error: " << asr.lastError() << std::endl;
+                    std::cerr << "Error: " << (asr_session ? asr_session->lastError() : asr.lastError()) << std::endl;
                 }
             }
         }
@@ -944,7 +1740,12 @@ int main(int argc, char** argv) {
     std::cout << "[assistant] prêt. tape /exit pour quitter.\n";
     std::cout << "[cfg] API_BASE=" << cfg.apiBase << " MODEL=" << cfg.model << "\n";
 
-    OpenAIClient client(cfg.apiBase, cfg.apiKey, cfg.model);
+    OpenAIClient client(cfg.apiBase, cfg.apiKey, cfg.model, args.offline, cfg.http2);
+    client.setTimeout(args.llmTimeout);
+    std::unique_ptr<ResponseCache> resp_cache = args.offline ? nullptr : makeResponseCache(args, cfg.model);
+    ContextConfig context_cfg;
+    context_cfg.maxTokens = static_cast<size_t>(args.historyTokens);
+    ConversationContext convo(context_cfg);
 
     MemoryStore mem;
     mem.load();
@@ -1033,9 +1834,27 @@ int main(int argc, char** argv) {
         }
 
         if (args.offline) { std::cout << "assistant> (offline) Echo: " << line << "\n"; continue; }
-        ChatResult r = client.chatOnce(line);
+        // Cache entries depend on the exchange before the question.
+        const std::string cache_context = resp_cache ? convo.lastExchange() : std::string();
+        std::string cached;
+        if (resp_cache && resp_cache->lookup(line, cache_context, cached)) {
+            std::cout << "assistant> " << cached << "\n";
+            convo.commit(line, cached);
+            continue;
+        }
+        std::vector<ChatMessage> messages = convo.messagesFor(line);
+        if (args.llmStream) {
+            std::cout << "assistant> " << std::flush;
+            bool partial = false;
+            ChatResult r = client.chatStream(messages, [&](const std::string& delta) { partial = true; std::cout << delta << std::flush; });
+            if (!r.ok) std::cout << (partial ? "\n" : "") << "[error] " << (!r.error.empty()?r.error:r.text) << "\n";
+            else     { std::cout << "\n"; convo.commit(line, r.text, r.promptTokens); if (resp_cache) resp_cache->store(line, cache_context, r.text); }
+            continue;
+        }
+        ChatResult r = client.chatOnce(messages);
         if (!r.ok) std::cout << "assistant> [error] " << (!r.error.empty()?r.error:r.text) << "\n";
-        else       std::cout << "assistant> " << r.text << "\n";
+        else     { std::cout << "assistant> " << r.text << "\n"; convo.commit(line, r.text, r.promptTokens); if (resp_cache) resp_cache->store(line, cache_context, r.text); }
     }
+    if (resp_cache) std::cout << resp_cache->statsLine() << std::endl;
     return 0;
 }